@@ -0,0 +1,99 @@
+/*
+** readbench.c - reader throughput on a generated corpus.
+**
+** Build it twice, with and without READ_COMPUTED_GOTO, etc.; "make bench".
+*/
+#define _GNU_SOURCE 1
+#include "lispvalue.c"
+#include "lispread.c"
+
+#include <time.h>
+
+static unsigned long bench_seed = 12345;
+
+static unsigned long bench_rand(unsigned long n)
+{
+  bench_seed = bench_seed * 6364136223846793005UL + 1442695040888963407UL;
+  return (bench_seed >> 33) % n;
+}
+
+static char *bench_p;
+
+static void bench_datum(int depth)
+{
+  static const char *symbols[] = { "define", "lambda", "x", "if", "car", "string->symbol", "a-long-symbol-name", "+", "vector-ref", "k" };
+  int i, n;
+
+  switch ( depth > 6 ? bench_rand(6) : bench_rand(10) ) {
+  case 0: case 1:
+    bench_p += sprintf(bench_p, "%s", symbols[bench_rand(10)]);
+    break;
+  case 2:
+    bench_p += sprintf(bench_p, "%ld", (long) bench_rand(100000) - 500);
+    break;
+  case 3:
+    bench_p += sprintf(bench_p, "%lu.%02lu", bench_rand(1000), bench_rand(100));
+    break;
+  case 4:
+    bench_p += sprintf(bench_p, "\"str %lu\\n\"", bench_rand(1000));
+    break;
+  case 5:
+    bench_p += sprintf(bench_p, "%s", bench_rand(2) ? "#t" : "#\\a");
+    break;
+  case 6:
+    *bench_p ++ = '\'';
+    bench_datum(depth + 1);
+    break;
+  case 7:
+    *bench_p ++ = '#';
+    /* Fall through. */
+  default:
+    *bench_p ++ = '(';
+    for ( i = 0, n = bench_rand(8); i < n; ++ i ) {
+      if ( i ) *bench_p ++ = bench_rand(8) ? ' ' : '\n';
+      bench_datum(depth + 1);
+    }
+    *bench_p ++ = ')';
+  }
+}
+
+static double bench_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+  size_t size = 16 * 1024 * 1024, len;
+  char *buf = bench_p = malloc(size + 4096);
+  double best = 0;
+  unsigned long datums = 0;
+  int round;
+
+  while ( bench_p - buf < (long) size ) {
+    if ( ! bench_rand(16) )
+      bench_p += sprintf(bench_p, "; comment %lu\n", bench_rand(1000));
+    bench_datum(0);
+    *bench_p ++ = '\n';
+  }
+  len = bench_p - buf;
+
+  for ( round = 0; round < 5; ++ round ) {
+    FILE *fp = fmemopen(buf, len, "r");
+    double t = bench_now();
+    VALUE x;
+
+    datums = 0;
+    while ( ! lv_read_file(fp, &x) && ! EQ(x, EOS) )
+      ++ datums;
+    t = bench_now() - t;
+    if ( ! best || t < best )
+      best = t;
+    fclose(fp);
+    lv_reset();
+  }
+  printf("%s: %lu bytes, %lu datums, %.1f MB/s\n", argv[0], (unsigned long) len, datums, len / best / 1e6);
+  return 0;
+}
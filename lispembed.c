@@ -0,0 +1,371 @@
+/*
+** lispembed.c - lispread-embed: s-expression files to static C data.
+*/
+/*
+lispread-embed reads s-expression files with lispread.c and lispvalue.c
+and writes a C file that holds their datums already built, in the
+lispvalue.c representation, so a program can use them without reading
+anything at startup:
+
+  lispread-embed [-n NAME] [-o OUT.c] FILE ...
+
+The generated file must be #included after "lispvalue.c":
+
+  #include "lispvalue.c"
+  #include "data.scm.c"
+
+  if ( NAME_init() < 0 ) ...
+  for ( i = 0; i < NAME_n; ++ i )
+    ... NAME_data[i] ...
+
+It defines:
+
+NAME_heap           The pairs, strings, vectors, flonums and typed vectors,
+                    as a const array of 16-byte aligned words.
+NAME_symbols        The symbols longer than LV_SHORT_MAX bytes.  Not const:
+                    they are linked into the lv_intern() table.
+NAME_data[NAME_n]   The datums of the files, in order.
+NAME_init()         Intern NAME_symbols with lv_intern_static().  Call it
+                    before interning their names otherwise, and again after
+                    lv_reset().  Returns -1 if a name was interned already.
+
+NAME defaults to the first FILE's name without its directory and
+extensions, with other than letters and digits replaced by '_'.
+Shared and cyclic structure read with datum labels is kept.
+The data is const: SET_CAR() and friends must not be used on it.
+The words are in the byte order of the machine lispread-embed runs on.
+
+The Makefile has rules to make FILE.scm.c from FILE.scm and FILE.sexp.c
+from FILE.sexp.
+
+*/
+
+#include "lispvalue.c"
+#include "lispread.c"
+
+/* Every heap or symbol object reached: where it is in the output. */
+struct emb_node {
+  VALUE x;
+  size_t at;            /* Word offset in NAME_heap or NAME_symbols. */
+  int symbol;           /* In NAME_symbols. */
+};
+
+static struct emb_node *emb_nodes;
+static size_t emb_nodes_size, emb_nodes_n;
+static VALUE *emb_order;        /* The objects in output order. */
+static size_t emb_heap_n, emb_symbols_n, emb_typed_n;
+static const char *emb_name;
+
+static
+struct emb_node *emb_find(VALUE x, int create)
+{
+  size_t i;
+
+  if ( create && emb_nodes_n * 2 >= emb_nodes_size ) {
+    struct emb_node *old = emb_nodes;
+    size_t old_size = emb_nodes_size;
+    emb_nodes_size = old_size ? old_size * 2 : 256;
+    emb_nodes = calloc(emb_nodes_size, sizeof(*old));
+    emb_order = realloc(emb_order, emb_nodes_size * sizeof(VALUE));
+    for ( i = 0; i < old_size; ++ i ) {
+      if ( old[i].x )
+	*emb_find(old[i].x, 0) = old[i];
+    }
+    free(old);
+  }
+  if ( ! emb_nodes )
+    return 0;
+  for ( i = HASH_VALUE(x) * 0x9e3779b97f4a7c15UL >> 7; ; ++ i ) {
+    struct emb_node *n = &emb_nodes[i & (emb_nodes_size - 1)];
+    if ( ! n->x ) {
+      if ( ! create )
+	return 0;
+      n->x = x;
+      emb_order[emb_nodes_n ++] = x;
+      return n;
+    }
+    if ( n->x == x )
+      return n;
+  }
+}
+
+/* Words taken by the object X, rounded up to keep the next one 16-byte aligned. */
+static
+size_t emb_words(VALUE x)
+{
+  size_t n = 2;
+
+  if ( LV_OBJECTQ(x) ) {
+    switch ( LV_TYPE(x) ) {
+    case LV_STRING: n = 1 + (LV_LENGTH(x) + 8) / 8; break;
+    case LV_SYMBOL: n = 3 + (LV_LENGTH(x) + 8) / 8; break;
+    case LV_VECTOR: n = 1 + LV_LENGTH(x); break;
+    case LV_TYPED_VECTOR: n = 4; break;
+    }
+  }
+  return (n + 1) & ~(size_t) 1;
+}
+
+/* Gives every object reached from X its place. */
+static
+void emb_place(VALUE x)
+{
+  while ( LV_PAIRQ(x) || LV_OBJECTQ(x) ) {
+    struct emb_node *n;
+    if ( emb_find(x, 0) )
+      return;
+    n = emb_find(x, 1);
+    if ( LV_TYPEQ(x, LV_SYMBOL) ) {
+      n->symbol = 1;
+      n->at = emb_symbols_n;
+      emb_symbols_n += emb_words(x);
+      return;
+    }
+    n->at = emb_heap_n;
+    emb_heap_n += emb_words(x);
+    if ( LV_VECTORQ(x) ) {
+      size_t i;
+      for ( i = 0; i < LV_LENGTH(x); ++ i )
+	emb_place(LV_VECTOR_REF(x, i));
+      return;
+    }
+    if ( ! LV_PAIRQ(x) )
+      return;
+    emb_place(lv_car(x));
+    x = lv_cdr(x);
+  }
+}
+
+/* Writes the word for VALUE X. */
+static
+void emb_value(FILE *out, VALUE x)
+{
+  struct emb_node *n;
+
+  if ( ! (LV_PAIRQ(x) || LV_OBJECTQ(x)) ) {
+    fprintf(out, "0x%llxULL", (unsigned long long) x);
+    return;
+  }
+  n = emb_find(x, 0);
+  fprintf(out, "LV_EMBED_REF(%s_%s, %lu, %d)", emb_name, n->symbol ? "symbols" : "heap",
+	  (unsigned long) n->at, LV_PAIRQ(x) ? LV_PAIR_TAG : LV_OBJECT_TAG);
+}
+
+/* Writes LEN bytes at P as words, NUL terminated. */
+static
+void emb_bytes(FILE *out, const char *p, size_t len)
+{
+  size_t i;
+
+  for ( i = 0; i <= len; i += 8 ) {
+    uint64_t w = 0;
+    memcpy(&w, p + i, len + 1 - i < 8 ? len - i : 8);
+    fprintf(out, ", 0x%llxULL", (unsigned long long) w);
+  }
+}
+
+static
+void emb_object(FILE *out, VALUE x)
+{
+  size_t i, n = emb_words(x), len;
+  struct emb_node *node = emb_find(x, 0);
+
+  fprintf(out, "  /* %lu */ ", (unsigned long) node->at);
+  if ( LV_PAIRQ(x) ) {
+    n -= 2;
+    emb_value(out, lv_car(x));
+    fprintf(out, ", ");
+    emb_value(out, lv_cdr(x));
+  } else {
+    len = LV_LENGTH(x);
+    fprintf(out, "0x%llxULL", (unsigned long long) LV_OBJECT(x)->header);
+    -- n;
+    switch ( LV_TYPE(x) ) {
+    case LV_STRING:
+      emb_bytes(out, ((struct lv_string*) LV_OBJECT(x))->data, len);
+      n -= (len + 8) / 8;
+      break;
+    case LV_SYMBOL: {
+      struct lv_symbol *s = (struct lv_symbol*) LV_OBJECT(x);
+      fprintf(out, ", 0, 0x%llxULL", (unsigned long long) s->hash);
+      emb_bytes(out, s->name, len);
+      n -= 2 + (len + 8) / 8;
+      break;
+    }
+    case LV_VECTOR:
+      for ( i = 0; i < len; ++ i ) {
+	fprintf(out, ", ");
+	emb_value(out, LV_VECTOR_REF(x, i));
+      }
+      n -= len;
+      break;
+    case LV_FLONUM: {
+      uint64_t w;
+      memcpy(&w, &LV_FLONUM_VALUE(x), sizeof(w));
+      fprintf(out, ", 0x%llxULL", (unsigned long long) w);
+      -- n;
+      break;
+    }
+    case LV_TYPED_VECTOR: {
+      struct lv_typed_vector *t = (struct lv_typed_vector*) LV_OBJECT(x);
+      uint64_t w = 0;
+      memcpy(&w, &t->kind, sizeof(t->kind));
+      fprintf(out, ", 0x%llxULL, 0, (VALUE) (uintptr_t) %s_typed_%lu", (unsigned long long) w, emb_name, (unsigned long) node->at);
+      n -= 3;
+      break;
+    }
+    }
+  }
+  while ( n -- > 0 )
+    fprintf(out, ", 0");
+  fprintf(out, ",\n");
+}
+
+/* Writes the elements of typed vector X as a static const array. */
+static
+void emb_typed_data(FILE *out, VALUE x)
+{
+  static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 8, 8, 4, 8 };
+  struct lv_typed_vector *t = (struct lv_typed_vector*) LV_OBJECT(x);
+  size_t i, size = sizes[t->kind], n = LV_LENGTH(x) * size;
+  const unsigned char *p = t->data;
+
+  fprintf(out, "static _Alignas(8) const unsigned char %s_typed_%lu[] = {", emb_name, (unsigned long) emb_find(x, 0)->at);
+  for ( i = 0; i < n; ++ i )
+    fprintf(out, "%s%u", ! i ? "\n  " : i % 16 ? ", " : ",\n  ", p[i]);
+  fprintf(out, "%s};\n", n ? "\n" : " 0 ");
+  ++ emb_typed_n;
+}
+
+static
+void emb_write(FILE *out, const char *files, VALUE *data, size_t data_n)
+{
+  size_t i;
+  uint16_t one = 1;
+
+  fprintf(out, "/* Generated by lispread-embed from %s.  Do not edit. */\n\n", files);
+  fprintf(out, "#ifndef LISPVALUE_C\n#error \"#include \\\"lispvalue.c\\\" first.\"\n#endif\n\n");
+  fprintf(out, "#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != %s\n", *(char*) &one ? "__ORDER_LITTLE_ENDIAN__" : "__ORDER_BIG_ENDIAN__");
+  fprintf(out, "#error \"Generated for another byte order.\"\n#endif\n\n");
+  fprintf(out, "#ifndef LV_EMBED_REF\n#define LV_EMBED_REF(A,I,TAG) ((VALUE) (uintptr_t) &(A)[I] + (TAG))\n#endif\n\n");
+
+  for ( i = 0; i < emb_nodes_n; ++ i ) {
+    if ( LV_TYPEQ(emb_order[i], LV_TYPED_VECTOR) )
+      emb_typed_data(out, emb_order[i]);
+  }
+  if ( emb_typed_n )
+    fprintf(out, "\n");
+
+  fprintf(out, "static _Alignas(16) VALUE %s_symbols[%lu] = {\n", emb_name, (unsigned long) (emb_symbols_n ? emb_symbols_n : 2));
+  for ( i = 0; i < emb_nodes_n; ++ i ) {
+    if ( emb_find(emb_order[i], 0)->symbol )
+      emb_object(out, emb_order[i]);
+  }
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "static _Alignas(16) const VALUE %s_heap[%lu] = {\n", emb_name, (unsigned long) (emb_heap_n ? emb_heap_n : 2));
+  for ( i = 0; i < emb_nodes_n; ++ i ) {
+    if ( ! emb_find(emb_order[i], 0)->symbol )
+      emb_object(out, emb_order[i]);
+  }
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "static const size_t %s_n = %lu;\n", emb_name, (unsigned long) data_n);
+  fprintf(out, "static const VALUE %s_data[%lu] = {\n", emb_name, (unsigned long) (data_n ? data_n : 1));
+  for ( i = 0; i < data_n; ++ i ) {
+    fprintf(out, "  ");
+    emb_value(out, data[i]);
+    fprintf(out, ",\n");
+  }
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "static\nint %s_init(void)\n{\n  int result = 0;\n", emb_name);
+  for ( i = 0; i < emb_nodes_n; ++ i ) {
+    struct emb_node *n = emb_find(emb_order[i], 0);
+    if ( n->symbol ) {
+      fprintf(out, "  if ( lv_intern_static(LV_EMBED_REF(%s_symbols, %lu, LV_OBJECT_TAG)) != LV_EMBED_REF(%s_symbols, %lu, LV_OBJECT_TAG) )\n    result = -1;\n",
+	      emb_name, (unsigned long) n->at, emb_name, (unsigned long) n->at);
+    }
+  }
+  fprintf(out, "  return result;\n}\n");
+}
+
+/* Makes a C identifier from the name of PATH. */
+static
+char *emb_default_name(const char *path)
+{
+  const char *p = strrchr(path, '/');
+  char *name = malloc(strlen(path) + 2), *q = name;
+
+  p = p ? p + 1 : path;
+  if ( isdigit((unsigned char) *p) )
+    *q ++ = '_';
+  for ( ; *p && *p != '.'; ++ p )
+    *q ++ = isalnum((unsigned char) *p) ? *p : '_';
+  *q = '\0';
+  return name;
+}
+
+int main(int argc, char **argv)
+{
+  const char *out_path = 0;
+  char files[256] = "";
+  VALUE *data = 0;
+  size_t data_n = 0, data_size = 0;
+  FILE *out = stdout;
+  int i;
+
+  for ( i = 1; i < argc && argv[i][0] == '-' && argv[i][1]; ++ i ) {
+    if ( ! strcmp(argv[i], "-n") && i + 1 < argc )
+      emb_name = argv[++ i];
+    else if ( ! strcmp(argv[i], "-o") && i + 1 < argc )
+      out_path = argv[++ i];
+    else
+      break;
+  }
+  if ( i == argc || argv[i][0] == '-' ) {
+    fprintf(stderr, "usage: %s [-n NAME] [-o OUT.c] FILE ...\n", argv[0]);
+    return 2;
+  }
+  if ( ! emb_name )
+    emb_name = emb_default_name(argv[i]);
+
+  for ( ; i < argc; ++ i ) {
+    FILE *fp = fopen(argv[i], "r");
+    VALUE x;
+    if ( ! fp ) {
+      fprintf(stderr, "lispread-embed: %s: %s\n", argv[i], strerror(errno));
+      return 1;
+    }
+    if ( strlen(files) + strlen(argv[i]) + 3 < sizeof(files) )
+      sprintf(files + strlen(files), "%s%s", files[0] ? " " : "", argv[i]);
+    while ( 1 ) {
+      if ( lv_read_file(fp, &x) ) {
+	fprintf(stderr, "lispread-embed: %s: %s\n", argv[i], lv_error_message);
+	return 1;
+      }
+      if ( EQ(x, EOS) )
+	break;
+      if ( data_n == data_size ) {
+	data_size = data_size ? data_size * 2 : 64;
+	data = realloc(data, data_size * sizeof(VALUE));
+      }
+      data[data_n ++] = x;
+      emb_place(x);
+    }
+    fclose(fp);
+  }
+
+  if ( out_path && ! (out = fopen(out_path, "w")) ) {
+    fprintf(stderr, "lispread-embed: %s: %s\n", out_path, strerror(errno));
+    return 1;
+  }
+  emb_write(out, files, data, data_n);
+  free(data);
+  lv_reset();
+  if ( fclose(out) ) {
+    fprintf(stderr, "lispread-embed: %s: %s\n", out_path ? out_path : "stdout", strerror(errno));
+    return 1;
+  }
+  return 0;
+}
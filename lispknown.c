@@ -0,0 +1,331 @@
+/*
+** lispknown.c - lispread-known: a perfect hash for a fixed symbol vocabulary.
+*/
+/*
+lispread-known reads the symbols in s-expression files and writes a C file
+with a collision-free hash of them, for lispread.c's KNOWN_SYMBOL():
+
+  lispread-known [-n NAME] [-o OUT.c] FILE ...
+
+Symbols may be nested in lists; other datums and repeated symbols are
+ignored.  Their ids are 0, 1, ... in the order they are first read.
+The generated file needs only the C library and defines:
+
+NAME_n              The number of symbols.
+NAME_name(ID)       The NUL terminated name of symbol ID.
+NAME_lookup(P,LEN)  Return the id of the LEN bytes at P, or -1.
+NAME_ID_x           An enum of the ids, with '?' in names replaced by 'Q',
+                    '!' by 'X' and other than letters and digits by '_'.
+
+NAME_lookup() hashes the bytes twice and compares them with at most one
+name: it never probes.  The hash is "hash and displace": a first hash
+picks one of about n/4 buckets, whose seed in NAME_disp[] was chosen so
+that a second hash sends every name of the bucket to its own slot.
+
+  #include "proto.syms.c"
+  #define KNOWN_SYMBOL(P,LEN) proto_lookup(P,LEN)
+  #define KNOWN_SYMBOL_VALUE(ID) proto_symbols[ID]
+  #include "lispread.c"
+
+A name that lispread.c would otherwise read as a number, like "-2" or
+"1e3", shadows the number, since KNOWN_SYMBOL() is called before
+STRING_2_NUMBER(); lispread-known warns about them.
+The Makefile makes FILE.syms.c from FILE.syms.
+
+*/
+
+#include "lispvalue.c"
+#include "lispread.c"
+
+static const char *known_name;
+static char **known_names;
+static size_t *known_lens;
+static size_t known_n, known_size;
+
+/* The hash used by the generated code, which prints it with known_write_hash(). */
+static
+uint32_t known_hash(const char *p, size_t len, uint32_t seed)
+{
+  uint32_t h = 0x811c9dc5U ^ (seed * 0x9e3779b9U);
+  size_t i;
+  for ( i = 0; i < len; ++ i )
+    h = (h ^ (unsigned char) p[i]) * 0x01000193U;
+  h ^= h >> 15;
+  h *= 0x2c1b3c6dU;
+  h ^= h >> 12;
+  return h;
+}
+
+static
+void known_write_hash(FILE *out)
+{
+  fprintf(out,
+	  "static\nunsigned long %s_hash(const char *p, size_t len, unsigned long seed)\n{\n"
+	  "  unsigned long h = (0x811c9dc5UL ^ (seed * 0x9e3779b9UL)) & 0xffffffffUL;\n"
+	  "  size_t i;\n"
+	  "  for ( i = 0; i < len; ++ i )\n"
+	  "    h = ((h ^ (unsigned char) p[i]) * 0x01000193UL) & 0xffffffffUL;\n"
+	  "  h ^= h >> 15;\n"
+	  "  h = (h * 0x2c1b3c6dUL) & 0xffffffffUL;\n"
+	  "  h ^= h >> 12;\n"
+	  "  return h;\n}\n\n", known_name);
+}
+
+static
+void known_add(VALUE x)
+{
+  char tmp[8];
+  size_t len, i;
+  const char *p;
+
+  while ( LV_PAIRQ(x) ) {
+    known_add(lv_car(x));
+    x = lv_cdr(x);
+  }
+  if ( ! lv_symbolQ(x) )
+    return;
+  p = lv_bytes(x, tmp, &len);
+  for ( i = 0; i < known_n; ++ i ) {
+    if ( known_lens[i] == len && ! memcmp(known_names[i], p, len) )
+      return;
+  }
+  if ( known_n == known_size ) {
+    known_size = known_size ? known_size * 2 : 64;
+    known_names = realloc(known_names, known_size * sizeof(known_names[0]));
+    known_lens = realloc(known_lens, known_size * sizeof(known_lens[0]));
+  }
+  known_names[known_n] = memcpy(calloc(len + 1, 1), p, len);
+  known_lens[known_n ++] = len;
+  if ( ! EQ(lv_string_2_number(lv_make_string(p, len), 10), F) )
+    fprintf(stderr, "lispread-known: warning: \"%s\" reads as a number\n", known_names[known_n - 1]);
+}
+
+/* The bucket of each id, and the number of ids in each bucket. */
+static size_t *known_bucket_of, *known_bucket_n, known_buckets_n;
+
+/* Largest bucket first. */
+static
+int known_bucket_cmp(const void *a, const void *b)
+{
+  size_t x = *(const size_t*) a, y = *(const size_t*) b;
+  if ( known_bucket_n[x] != known_bucket_n[y] )
+    return known_bucket_n[x] < known_bucket_n[y] ? 1 : -1;
+  return (x > y) - (x < y);
+}
+
+/* Finds the seeds of the buckets; returns the slot of each id in SLOT_IDS. */
+static
+int known_place(size_t slots_n, uint32_t *disp, long *slot_ids)
+{
+  size_t *order = malloc(known_buckets_n * sizeof(*order));
+  size_t b, i, j, k;
+
+  for ( b = 0; b < known_buckets_n; ++ b ) {
+    order[b] = b;
+    known_bucket_n[b] = 0;
+  }
+  for ( i = 0; i < known_n; ++ i ) {
+    known_bucket_of[i] = known_hash(known_names[i], known_lens[i], 0) % known_buckets_n;
+    ++ known_bucket_n[known_bucket_of[i]];
+  }
+  qsort(order, known_buckets_n, sizeof(*order), known_bucket_cmp);
+  for ( i = 0; i < slots_n; ++ i )
+    slot_ids[i] = -1;
+
+  for ( k = 0; k < known_buckets_n; ++ k ) {
+    uint32_t seed;
+    b = order[k];
+    for ( seed = 1; seed < 1000000; ++ seed ) {
+      int ok = 1;
+      for ( i = 0; ok && i < known_n; ++ i ) {
+	size_t s;
+	if ( known_bucket_of[i] != b )
+	  continue;
+	s = known_hash(known_names[i], known_lens[i], seed) % slots_n;
+	if ( slot_ids[s] >= 0 )
+	  ok = 0;
+	else
+	  slot_ids[s] = i;
+      }
+      if ( ok )
+	break;
+      /* Undo the slots taken by this bucket with this seed. */
+      for ( j = 0; j < slots_n; ++ j ) {
+	if ( slot_ids[j] >= 0 && known_bucket_of[slot_ids[j]] == b )
+	  slot_ids[j] = -1;
+      }
+    }
+    if ( seed == 1000000 ) {
+      free(order);
+      return -1;
+    }
+    disp[b] = seed;
+  }
+  free(order);
+  return 0;
+}
+
+static
+void known_write(FILE *out, const char *files, size_t slots_n, const uint32_t *disp, const long *slot_ids)
+{
+  size_t i, j, off;
+  char **ids = malloc((known_n + 1) * sizeof(*ids));
+
+  fprintf(out, "/* Generated by lispread-known from %s.  Do not edit. */\n\n", files);
+  fprintf(out, "#include <stddef.h>\n#include <string.h>\n\n");
+
+  fprintf(out, "enum {\n");
+  for ( i = 0; i < known_n; ++ i ) {
+    /* The C name, made unique with the id if need be. */
+    char *c = ids[i] = malloc(known_lens[i] + 24);
+    for ( j = 0; j < known_lens[i]; ++ j ) {
+      int ch = (unsigned char) known_names[i][j];
+      *c ++ = ch == '?' ? 'Q' : ch == '!' ? 'X' : isalnum(ch) ? ch : '_';
+    }
+    *c = '\0';
+    for ( j = 0; j < i; ++ j ) {
+      if ( ! strcmp(ids[i], ids[j]) ) {
+	sprintf(c, "_%lu", (unsigned long) i);
+	break;
+      }
+    }
+    fprintf(out, "  %s_ID_%s = %lu,\n", known_name, ids[i], (unsigned long) i);
+  }
+  fprintf(out, "};\n\n");
+  for ( i = 0; i < known_n; ++ i )
+    free(ids[i]);
+  free(ids);
+
+  fprintf(out, "static const size_t %s_n = %lu;\n\n", known_name, (unsigned long) known_n);
+  fprintf(out, "static const char %s_pool[] =", known_name);
+  for ( i = 0; i < known_n; ++ i ) {
+    fprintf(out, "\n  \"");
+    for ( j = 0; j < known_lens[i]; ++ j ) {
+      int c = (unsigned char) known_names[i][j];
+      if ( c == '"' || c == '\\' || c == '?' ) fprintf(out, "\\%c", c);
+      else if ( isprint(c) ) putc(c, out);
+      else fprintf(out, "\\%03o", c);
+    }
+    fprintf(out, "\\0\"");
+  }
+  fprintf(out, "%s;\n\n", known_n ? "" : " \"\"");
+
+  fprintf(out, "/* The offset of each name in %s_pool, and the offset after the last one. */\n", known_name);
+  fprintf(out, "static const unsigned long %s_offsets[%lu] = {", known_name, (unsigned long) known_n + 1);
+  for ( i = off = 0; i <= known_n; off += i < known_n ? known_lens[i] + 1 : 0, ++ i )
+    fprintf(out, "%s%lu", ! i ? "\n  " : i % 8 ? ", " : ",\n  ", (unsigned long) off);
+  fprintf(out, "\n};\n\n");
+
+  fprintf(out, "static const unsigned long %s_disp[%lu] = {", known_name, (unsigned long) known_buckets_n);
+  for ( i = 0; i < known_buckets_n; ++ i )
+    fprintf(out, "%s%lu", ! i ? "\n  " : i % 8 ? ", " : ",\n  ", (unsigned long) disp[i]);
+  fprintf(out, "\n};\n\n");
+
+  fprintf(out, "/* The id in each slot, or -1. */\n");
+  fprintf(out, "static const %s %s_slots[%lu] = {", known_n < 32767 ? "short" : "long", known_name, (unsigned long) slots_n);
+  for ( i = 0; i < slots_n; ++ i )
+    fprintf(out, "%s%ld", ! i ? "\n  " : i % 16 ? ", " : ",\n  ", slot_ids[i]);
+  fprintf(out, "\n};\n\n");
+
+  known_write_hash(out);
+
+  fprintf(out, "#define %s_name(ID) (%s_pool + %s_offsets[ID])\n\n", known_name, known_name, known_name);
+  fprintf(out,
+	  "static\nint %s_lookup(const char *p, size_t len)\n{\n"
+	  "  unsigned long b = %s_hash(p, len, 0) %% %luUL;\n"
+	  "  int id = %s_slots[%s_hash(p, len, %s_disp[b]) %% %luUL];\n"
+	  "  if ( id < 0 || %s_offsets[id + 1] - %s_offsets[id] != len + 1 || memcmp(%s_pool + %s_offsets[id], p, len) )\n"
+	  "    return -1;\n"
+	  "  return id;\n}\n",
+	  known_name, known_name, (unsigned long) known_buckets_n, known_name, known_name, known_name, (unsigned long) slots_n,
+	  known_name, known_name, known_name, known_name);
+}
+
+/* Makes a C identifier from the name of PATH. */
+static
+char *known_default_name(const char *path)
+{
+  const char *p = strrchr(path, '/');
+  char *name = malloc(strlen(path) + 2), *q = name;
+
+  p = p ? p + 1 : path;
+  if ( isdigit((unsigned char) *p) )
+    *q ++ = '_';
+  for ( ; *p && *p != '.'; ++ p )
+    *q ++ = isalnum((unsigned char) *p) ? *p : '_';
+  *q = '\0';
+  return name;
+}
+
+int main(int argc, char **argv)
+{
+  const char *out_path = 0;
+  char files[256] = "";
+  FILE *out = stdout;
+  size_t slots_n;
+  uint32_t *disp;
+  long *slot_ids;
+  int i;
+
+  for ( i = 1; i < argc && argv[i][0] == '-' && argv[i][1]; ++ i ) {
+    if ( ! strcmp(argv[i], "-n") && i + 1 < argc )
+      known_name = argv[++ i];
+    else if ( ! strcmp(argv[i], "-o") && i + 1 < argc )
+      out_path = argv[++ i];
+    else
+      break;
+  }
+  if ( i == argc || argv[i][0] == '-' ) {
+    fprintf(stderr, "usage: %s [-n NAME] [-o OUT.c] FILE ...\n", argv[0]);
+    return 2;
+  }
+  if ( ! known_name )
+    known_name = known_default_name(argv[i]);
+
+  for ( ; i < argc; ++ i ) {
+    FILE *fp = fopen(argv[i], "r");
+    VALUE x;
+    if ( ! fp ) {
+      fprintf(stderr, "lispread-known: %s: %s\n", argv[i], strerror(errno));
+      return 1;
+    }
+    if ( strlen(files) + strlen(argv[i]) + 3 < sizeof(files) )
+      sprintf(files + strlen(files), "%s%s", files[0] ? " " : "", argv[i]);
+    while ( 1 ) {
+      if ( lv_read_file(fp, &x) ) {
+	fprintf(stderr, "lispread-known: %s: %s\n", argv[i], lv_error_message);
+	return 1;
+      }
+      if ( EQ(x, EOS) )
+	break;
+      known_add(x);
+    }
+    fclose(fp);
+  }
+
+  /* About 4 names per bucket and 1.25 slots per name. */
+  known_buckets_n = known_n / 4 + 1;
+  slots_n = known_n + known_n / 4 + 1;
+  known_bucket_of = malloc((known_n + 1) * sizeof(*known_bucket_of));
+  known_bucket_n = malloc(known_buckets_n * sizeof(*known_bucket_n));
+  disp = malloc(known_buckets_n * sizeof(*disp));
+  slot_ids = malloc(slots_n * sizeof(*slot_ids));
+  while ( known_place(slots_n, disp, slot_ids) < 0 ) {
+    slots_n += slots_n / 8 + 1;
+    slot_ids = realloc(slot_ids, slots_n * sizeof(*slot_ids));
+  }
+
+  if ( out_path && ! (out = fopen(out_path, "w")) ) {
+    fprintf(stderr, "lispread-known: %s: %s\n", out_path, strerror(errno));
+    return 1;
+  }
+  known_write(out, files, slots_n, disp, slot_ids);
+  if ( fclose(out) ) {
+    fprintf(stderr, "lispread-known: %s: %s\n", out_path ? out_path : "stdout", strerror(errno));
+    return 1;
+  }
+  free(disp);
+  free(slot_ids);
+  lv_reset();
+  return 0;
+}
@@ -24,11 +24,14 @@ Conses        (a . d)
               [a . d]      (Optional)
 Vectors       #(a b ...)
               #[a b ...)   (Optional)
-Characters    #\C, #\space, #\newline
+Typed vectors #u8(1 2 ...), #s16(...), #f64(1.5 ...), etc.  (Optional)
+Tables        #hash((k . v) ...), #{k v ...}  (Optional)
+Characters    #\C, #\space, #\newline, #\tab, etc., #\x41
 False         #f, #F
 True          #t, #T
 Unspecified   #u, #U       (Optional)
 Logical EOF   ##           (Optional)
+Datum labels  #0=(a . #0#), #1=x   (Optional)
 Numbers       #b0101001, #o1726m #d2349, #x0123456789abcedf, 1234, 1234.00, etc.
 Strings       "...", "\"\\"
 Symbols       asdf, +, etc.
@@ -47,6 +50,14 @@ READ_DECL           A C function definition for the lisp read function.
 READ_DECL_END       Terminate the read C function definition.  Opt.
 READ_CALL()         Call the lisp read function recursively.
 RETURN(X)           Return a VALUE from the READ_DECL function.  Opt.
+READ_CTX            A "struct read_ctx *" for the reader state of "stream".  Opt.
+                    Defaults to a single static context.
+                    It may only refer to the "stream" variable.
+READ_LIMITS         If defined, enforce the limits in READ_CTX->limits.  Opt.
+READ_YIELD          If defined, a read can yield and be resumed or cancelled.  Opt.
+YIELD               The VALUE returned by a read that yielded.  For READ_YIELD.
+READ_CLOCK()        Return the current time as an unsigned long.  Opt.
+                    Needed for READ_CTX->deadline.
 
 MALLOC(s)           Allocate a character memory buffer from lisp.
 REALLOC(p,s)        Reallocate a previously MALLOCed buffer from lisp.
@@ -58,16 +69,41 @@ GETC(stream)        Read a C char or EOF from the stream.
 
 EOS                 The end-of-stream VALUE.
 CONS(X,Y)           Return a new lisp CONS object.
+MAKE_LIST(P,N,TAIL) Return a list of the N > 0 VALUEs at P followed by TAIL.  Opt.
+                    P is reused after the call.  See "Compact lists" below.
 CAR(CONS)           Get the car field of a pair VALUE as in: (car CONS)
 SET_CDR(CONS,V)     Set the cdr field of a pair VALUE as in: (set-cdr! CONS V)
 SET(LOC,V)          Set a local variable as in (set! VARIABLE V).  Opt.  
 
+READ_DATUM_LABELS   If defined, read R7RS #n= and #n# datum labels.  Opt.
+PAIRQ(X)            Return non-zero C value if X is a pair.  For READ_DATUM_LABELS.
+CDR(CONS)           Get the cdr field of a pair VALUE.  For READ_DATUM_LABELS.
+SET_CAR(CONS,V)     Set the car field of a pair VALUE.  For READ_DATUM_LABELS.
+VECTORQ(X)          Return non-zero C value if X is a vector.  Opt.
+VECTOR_LENGTH(X)    Return the C length of vector X.  For VECTORQ.
+VECTOR_REF(X,I)     Return element I of vector X.  For VECTORQ.
+VECTOR_SET(X,I,V)   Set element I of vector X.  For VECTORQ.
+
 MAKE_CHAR(I)        Create a lisp CHARACTER VALUE from a C integer.
+READ_UTF8           If defined, read UTF-8.  See "UTF-8" below.  Opt.
 
 LIST_2_VECTOR(X)    Convert list VALUE X into a VECTOR VALUE.
+MAKE_TYPED_VECTOR(K,P,N)  Create a packed vector VALUE of kind K (TYPED_VECTOR_U8, ...)
+                    from a MALLOCed buffer P of N native elements.  Opt.
+                    If defined, SRFI-4 #u8(...), #s8, #u16, #s16, #u32, #s32,
+                    #u64, #s64, #f32 and #f64 literals are read.
 BRACKET_LISTS       If defined, support [...] bracketed list syntax.
 
+MAKE_TABLE(N)       Create a new table VALUE for about N entries.  Opt.
+                    If defined, #hash((k . v) ...) and #{k v ...} are read
+                    into tables directly, without building an alist.
+TABLE_PUT(T,K,V)    Store V under key K in table T.
+TABLE_SIZE_HINT(S,C) Return a cheap estimate of the number of entries
+                    before the C terminator in stream S, or 0.  Opt.
+
 STRING(char*,int)   Create a new lisp STRING VALUE from a MALLOCed buffer.
+STRING_COPIES       Define if STRING() copies the buffer instead of keeping it;  Opt.
+                    the reader then FREEs its token and string buffers.
 ESCAPE_STRING(X)    Return a new STRING VALUE with escaped characters (\\, \") replaced.  Opt.
 STRING_2_NUMBER(X)  Convert string VALUE X into a NUMBER VALUE, or return F.
 STRING_2_SYMBOL(X)  Convert string VALUE X into a SYMBOL VALUE.
@@ -78,6 +114,10 @@ SYMBOL_DOT          The "." symbol.
 CALL_MACRO_CHAR(X)  Call the macro character function for the C char X.  
                     If the function returns F, continue scanning, 
                     otherwise return the CAR of the result.  Opt.
+READ_MACROS         If defined, READ_CTX->macros may point to a table of read
+                    macros.  See "Read macros" below.  Opt.
+READ_COMPUTED_GOTO  If defined, use the table-driven dispatch.  Opt.
+                    See "Table-driven dispatch" below.
 
 EQ(X,Y)             Return non-zero C value if (eq? X Y).
 
@@ -88,109 +128,1736 @@ U                   The unspecified VALUE for #u.  Opt.
 
 ERROR(format,...)   Raise an error using the printf() format.
 
-*/
+READ_STRING_CACHE   If defined, share identical string literal VALUEs.  Opt.
+READ_STRING_CACHE_SIZE  Number of string cache entries, a power of 2.  Opt.
+READ_STRING_CACHE_STRING_MAX  Longest string literal that is cached.  Opt.
+
+READ_SYMBOL_TABLE   If defined, the reader interns symbol tokens itself.  Opt.
+READ_SYMBOL_MAX     Default cap on the number of interned symbols.  Opt.
+MAKE_SYMBOL(X)      Create a new symbol VALUE named by string VALUE X.  Opt.
+                    Defaults to STRING_2_SYMBOL(X).  See "Symbol table" below.
+MAKE_UNINTERNED_SYMBOL(X)  Create an uninterned symbol named by string X.  Opt.
+                    Defaults to returning the string X.
+SYMBOL_LIVEQ(X)     Return non-zero if symbol X is still referenced.  Opt.
+KNOWN_SYMBOL(P,LEN) Return the id >= 0 of the token of LEN bytes at P if it is  Opt.
+                    in a fixed vocabulary, or -1.  See "Known symbols" below.
+KNOWN_SYMBOL_VALUE(ID)  Return the symbol VALUE for a KNOWN_SYMBOL() id.
+
+READ_HASH_CONS      If defined, intern lists, vectors, strings and tokens.  Opt.
+                    Implies READ_STRING_CACHE.
+READ_HASH_CONS_SIZE Number of hash-cons table entries, a power of 2.  Opt.
+READ_HASH_CONS_STRING_MAX  Longest token that is interned.  Opt.
+HASH_VALUE(X)       Return an unsigned long hash of VALUE X.  Opt.
+
+String cache:
+
+If READ_STRING_CACHE is defined, a string literal whose bytes were seen
+recently returns the same immutable STRING VALUE, without calling STRING().
+The lookup uses a hash computed while the string is scanned.
+The cache is 4-way set associative and holds at most READ_STRING_CACHE_SIZE
+strings of at most READ_STRING_CACHE_STRING_MAX bytes; longer strings bypass it.
+string_cache_hits and string_cache_misses count lookups.
+Like the hash-cons table below, it holds VALUEs: see string_cache_clear().
+
+Symbol table:
+
+If READ_SYMBOL_TABLE is defined, symbol tokens are interned in a table
+owned by the reader, using the hash computed while the token is scanned.
+New names call MAKE_SYMBOL() instead of STRING_2_SYMBOL().
+The host should define SYMBOL(NAME) and SYMBOL_DOT with
+symbol_table_intern(name, len, 1), which interns permanent symbols.
+
+At most symbol_table_max (initially READ_SYMBOL_MAX) symbols are interned;
+past the cap, new tokens become MAKE_UNINTERNED_SYMBOL() and are counted
+in symbol_table_uninterned.
+
+Every entry records the symbol_table_epoch it was last read in.
+symbol_table_reclaim(E) removes non-permanent entries last read before
+epoch E, so a long-running reader can advance symbol_table_epoch per
+request or batch and drop the names it stopped seeing.  If SYMBOL_LIVEQ()
+is defined the table is weak: only entries whose symbol is no longer
+referenced are removed, so EQ-ness of live symbols is preserved.
+Without it, the host must not hold symbols read before epoch E.
+
+Symbol memory is only bounded if the host defines MAKE_SYMBOL() to make
+a symbol that nothing else interns.  The default, STRING_2_SYMBOL(), is
+usually the host's own intern table, which keeps every name it is given
+however many entries the reader reclaims.
+
+Known symbols:
+
+If KNOWN_SYMBOL is defined, every token without a #b, #o, #d or #x prefix
+is first looked up with KNOWN_SYMBOL(); a known one returns
+KNOWN_SYMBOL_VALUE(id) at once, without STRING(), STRING_2_NUMBER(),
+the symbol table or STRING_2_SYMBOL().  So the vocabulary must not
+contain names that read as numbers.  lispknown.c builds lispread-known,
+which generates a perfect hash NAME_lookup() for a vocabulary that is
+suitable as KNOWN_SYMBOL.
+
+UTF-8:
+
+If READ_UTF8 is defined, symbols, numbers and strings with bytes of 128
+and above must be valid UTF-8, or ERROR() is called; overlong forms,
+surrogates and code points above 0x10FFFF are invalid.  Only those
+are checked, when they end, so ASCII is read as before.
+"#\" followed by a UTF-8 character, as in #\λ, and the R7RS #\x3BB
+call MAKE_CHAR() with the code point.  In strings, the R7RS escape
+"\x3BB;" is replaced with the UTF-8 bytes of the code point before
+ESCAPE_STRING() is called.
+
+Read macros:
+
+If READ_MACROS is defined and READ_CTX->macros is not 0, it is a
+struct read_macros with a function for each character that starts a
+datum, top[c], and for each character after '#', hash[c].  A 0 entry,
+as set by read_macros_init(), keeps the built-in syntax, which stays
+inline in the reader; any entry, built-in or not, can be replaced:
+
+  static int read_map(VALUE stream, int c, VALUE *xp)
+  {
+    *xp = CONS(SYMBOL(map), read_macro_list(stream, '}'));
+    return 1;
+  }
+
+  read_macros_init(&m);
+  read_macros_set(&m, '{', read_map, 1);
+  read_macros_set(&m, '}', 0, 1);
+  READ_CTX->macros = &m;
+
+The function is called with C taken from the stream.  It returns 1 with
+the datum in *XP, or 0 if the text was a comment and the reader should
+continue.  It may read datums with the READ_DECL function, or with
+read_macro_list(stream, terminator), and raise ERROR().
+terminating[c] is non-zero if C ends a symbol or number token;
+read_macros_set() sets it, so "a@b" can stay one symbol while "a{b"
+cannot.  Within a read macro no READ_CALL() yields.
+
+Table-driven dispatch:
+
+If READ_COMPUTED_GOTO is defined and the compiler is GCC or clang, the
+character that starts a datum jumps through a 256-entry table of label
+addresses instead of the switch, and whitespace and token terminators
+are found with a 256-entry character class table instead of comparisons
+and isspace().  Whitespace is then the C locale's.  "make bench" compares
+it with the switch on a generated corpus.
+
+Reader context:
+
+The reader keeps the state of a read that spans recursive READ_CALL()s,
+such as the nesting depth and datum labels, in the struct read_ctx at
+READ_CTX.  If ERROR() does not return, call read_ctx_reset(READ_CTX)
+before reading from the stream again.
+
+Resource limits:
+
+If READ_LIMITS is defined, READ_CTX->limits[] bounds what one top-level
+datum may consume; a limit of 0, the default, is no limit.
+
+READ_LIMIT_DEPTH    Nesting depth of lists, vectors, quotes, etc.
+READ_LIMIT_TOKEN    Bytes in a symbol, number, string or character name.
+READ_LIMIT_DATUM    Bytes taken from the stream, including whitespace and comments.
+READ_LIMIT_ALLOC    Bytes allocated: token and string buffers, typed vector
+                    data and 2 * sizeof(VALUE) for each pair or table entry.
+
+Exceeding one calls ERROR("read %s limit of %lu exceeded", ...) after
+freeing the reader's own buffers.  Limits are checked as each datum is
+started and as tokens grow, so a datum may go slightly over a limit
+before it is stopped.  READ_CTX->bytes - READ_CTX->datum_start and
+READ_CTX->allocated hold the counts for the current datum.
+
+Time-sliced reads:
+
+If READ_YIELD is defined, a read returns YIELD when READ_CTX->budget bytes
+have been taken from the stream, or when READ_CLOCK() reaches
+READ_CTX->deadline, since the read was called.  The state of the datum is
+saved in READ_CTX; calling the read again with the same context
+continues it where it stopped.  The host sets budget and deadline for
+each call; 0 means no limit.
+
+The budget is checked as each element is started, so a slice may run
+over by one token, and READ_CLOCK() is called at most every
+READ_YIELD_CLOCK_BYTES bytes.  Lists, vectors, quotes, "#;" and "#n="
+can be resumed; within a table no element yields.
+
+Setting READ_CTX->cancel makes the read call ERROR("read cancelled")
+at the same points, after dropping its saved state.
+
+While a read has yielded, the elements read so far are only referenced
+from READ_CTX->frames; a host with a precise GC must not collect then.
+
+Datum labels:
+
+If READ_DATUM_LABELS is defined, "#n=DATUM" labels DATUM and "#n#" refers
+to it, so shared and cyclic structure can be read.  Labels are scoped to
+the top-level datum.  Labels below READ_LABELS_SMALL are kept in an array
+in the context; larger labels go to an open-addressed table.
+A reference inside the datum it labels, as in #0=(a . #0#), returns
+a placeholder pair that is replaced using SET_CAR(), SET_CDR() and
+VECTOR_SET() once the datum is read.  Placeholders inside tables and
+other opaque objects are not replaced.
+
+Compact lists:
+
+If MAKE_LIST is defined, the elements of a list are collected in an array
+and the whole list is made by one MAKE_LIST() call instead of one CONS()
+per element, so the host can store it cdr-coded: the cars in a single
+block followed by a code for the tail.  The datum label patching only
+calls SET_CDR() on the last pair of such a list.
+MAKE_LIST is not used with READ_HASH_CONS, which interns every pair.
+
+Hash-consing:
+
+If READ_HASH_CONS is defined, identical subtrees come back as the same VALUE.
+Conses are interned on their (car, cdr) pair, after their elements are
+interned, so whole lists and vectors are shared.  Number/symbol tokens are
+interned on their bytes and strings go through the string cache.  The table is 4-way set associative:
+a new entry evicts the oldest entry in its set, so memory stays bounded
+by READ_HASH_CONS_SIZE.
+Interned structure is shared and must not be mutated by the caller.
+The table holds VALUEs; a host with a precise GC must either mark
+hash_cons_table[i].v or call hash_cons_clear() before collecting.
+
+*/
+
+#ifdef READ_DECL
+
+#include <ctype.h> /* isspace() */
+#include <string.h> /* memcpy() */
+#include <limits.h> /* ULONG_MAX */
+
+#if defined(READ_COMPUTED_GOTO) && ! defined(__GNUC__)
+#undef READ_COMPUTED_GOTO
+#endif
+
+#ifndef SET
+#define SET(X,V) ((X) = (V))
+#endif
+
+#ifndef PEEKC
+#define PEEKC(stream) \
+  ({ int _pc = GETC(stream); if ( _pc != EOF ) UNGETC(stream, _pc); _pc; })
+#endif
+
+#ifndef READ_DEBUG
+#ifdef READ_DEBUG_WHITESPACE
+#define READ_DEBUG 1
+#endif
+#endif
+
+#ifndef READ_DEBUG
+#define READ_DEBUG 0
+#endif
+
+#ifndef READ_STATE
+#define READ_STATE
+#endif
+
+#ifndef F
+#define F NIL
+#endif
+
+#ifdef MAKE_TABLE
+#ifndef TABLE_SIZE_HINT
+#define TABLE_SIZE_HINT(S,C) 0
+#endif
+#endif
+
+#ifdef READ_DATUM_LABELS
+
+#ifndef READ_LABELS_SMALL
+#define READ_LABELS_SMALL 16
+#endif
+
+enum {
+  READ_LABEL_UNUSED,
+  READ_LABEL_PENDING,   /* Its datum is being read. */
+  READ_LABEL_DEFINED,
+};
+
+struct read_label {
+  unsigned long n;
+  int state;
+  int referenced;       /* PENDING: v is a placeholder that was returned. */
+  VALUE v;
+};
+
+#endif
+
+#ifdef READ_LIMITS
+
+enum {
+  READ_LIMIT_DEPTH,     /* Nesting depth. */
+  READ_LIMIT_TOKEN,     /* Bytes in a token, string or character name. */
+  READ_LIMIT_DATUM,     /* Bytes consumed by a top-level datum. */
+  READ_LIMIT_ALLOC,     /* Bytes allocated for a top-level datum. */
+  READ_LIMIT_N
+};
+
+static const char *read_limit_names[READ_LIMIT_N] = { "depth", "token", "datum", "allocation" };
+
+#endif
+
+#if defined(READ_LIMITS) || defined(READ_YIELD)
+#define READ_COUNT_BYTES 1
+#endif
+
+#ifdef READ_MACROS
+
+/* Returns 1 with the datum in *XP, or 0 to continue reading. */
+typedef int (*read_macro_fn)(VALUE stream, int c, VALUE *xp);
+
+struct read_macros {
+  read_macro_fn top[256];       /* For C starting a datum; 0 is built-in. */
+  read_macro_fn hash[256];      /* For C after '#'; 0 is built-in. */
+  unsigned char terminating[256]; /* C ends a token. */
+};
+
+#endif
+
+#if defined(READ_HASH_CONS) || defined(MAKE_LIST)
+#define READ_LIST_ITEMS 1
+#endif
+
+struct read_ctx {
+  int depth;
+#ifdef READ_LIST_ITEMS
+  VALUE **list_items;           /* The MALLOCed items of the open lists. */
+  size_t list_items_n, list_items_size;
+#endif
+#ifdef READ_MACROS
+  const struct read_macros *macros; /* 0 is the built-in syntax. */
+#endif
+#ifdef READ_COUNT_BYTES
+  size_t bytes;                 /* Taken from the stream by this context. */
+#endif
+#ifdef READ_LIMITS
+  size_t limits[READ_LIMIT_N];  /* 0 is no limit. */
+  size_t datum_start, allocated;
+#endif
+#ifdef READ_YIELD
+  size_t budget;                /* Bytes per slice; 0 is no limit. */
+  unsigned long deadline;       /* READ_CLOCK() to end the slice at; 0 is none. */
+  volatile int cancel;
+  size_t slice_start, clock_bytes;
+  int no_yield_depth;           /* Inside a datum that cannot be resumed. */
+  struct read_frame *frames;    /* frames[d - 1] resumes depth d. */
+  size_t frames_n, frames_size;
+#endif
+#ifdef READ_DATUM_LABELS
+  int labels_used;
+  struct read_label labels_small[READ_LABELS_SMALL];
+  struct read_label *labels;    /* Open-addressed, for n >= READ_LABELS_SMALL. */
+  size_t labels_size, labels_n;
+#endif
+};
+
+#ifndef READ_CTX
+static struct read_ctx read_ctx;
+#define READ_CTX (&read_ctx)
+#endif
+
+#ifdef READ_COUNT_BYTES
+#define READ_GETC(S) (++ READ_CTX->bytes, GETC(S))
+#else
+#define READ_GETC(S) GETC(S)
+#endif
+
+#ifdef READ_LIMITS
+#define READ_ALLOCATED(N) (READ_CTX->allocated += (N))
+#else
+#define READ_ALLOCATED(N) ((void) 0)
+#endif
+
+#ifdef READ_LIMITS
+
+/* Returns the READ_LIMIT_* that CTX is over, counting PENDING more bytes allocated, or -1. */
+static
+int read_limit_exceeded(struct read_ctx *ctx, size_t pending)
+{
+  if ( ctx->limits[READ_LIMIT_DEPTH] && (size_t) ctx->depth > ctx->limits[READ_LIMIT_DEPTH] )
+    return READ_LIMIT_DEPTH;
+  if ( ctx->limits[READ_LIMIT_DATUM] && ctx->bytes - ctx->datum_start > ctx->limits[READ_LIMIT_DATUM] )
+    return READ_LIMIT_DATUM;
+  if ( ctx->limits[READ_LIMIT_ALLOC] && ctx->allocated + pending > ctx->limits[READ_LIMIT_ALLOC] )
+    return READ_LIMIT_ALLOC;
+  return -1;
+}
+
+/* Returns the READ_LIMIT_* that a token of LEN bytes is over, or -1. */
+static
+int read_limit_token(struct read_ctx *ctx, size_t len)
+{
+  if ( ctx->limits[READ_LIMIT_TOKEN] && len > ctx->limits[READ_LIMIT_TOKEN] )
+    return READ_LIMIT_TOKEN;
+  /* Check the others every 4K bytes of a long token. */
+  if ( (len & 4095) == 0 )
+    return read_limit_exceeded(ctx, len);
+  return -1;
+}
+
+#define READ_LIMIT_ERROR(L) \
+  ERROR("read %s limit of %lu exceeded", read_limit_names[L], (unsigned long) READ_CTX->limits[L])
+#define READ_CHECK_LIMITS() do { \
+    int _read_l = read_limit_exceeded(READ_CTX, 0); \
+    if ( _read_l >= 0 ) READ_RETURN(READ_LIMIT_ERROR(_read_l)); \
+  } while ( 0 )
+#define READ_CHECK_TOKEN(LEN,BUF) do { \
+    int _read_l = read_limit_token(READ_CTX, (LEN)); \
+    if ( _read_l >= 0 ) { FREE(BUF); READ_RETURN(READ_LIMIT_ERROR(_read_l)); } \
+  } while ( 0 )
+/* For a token in a buffer on the stack. */
+#define READ_CHECK_TOKEN_LENGTH(LEN) do { \
+    int _read_l = read_limit_token(READ_CTX, (LEN)); \
+    if ( _read_l >= 0 ) READ_RETURN(READ_LIMIT_ERROR(_read_l)); \
+  } while ( 0 )
+
+#else
+
+#define READ_CHECK_LIMITS() ((void) 0)
+#define READ_CHECK_TOKEN(LEN,BUF) ((void) 0)
+#define READ_CHECK_TOKEN_LENGTH(LEN) ((void) 0)
+
+#endif
+
+#ifdef READ_COMPUTED_GOTO
+
+enum {
+  READ_CC_SPACE = 1,            /* isspace() in the C locale. */
+  READ_CC_TERMINATOR = 2,       /* Ends a token. */
+};
+
+static const unsigned char read_char_class[256] = {
+  [' '] = 3, ['\t'] = 3, ['\n'] = 3, ['\v'] = 3, ['\f'] = 3, ['\r'] = 3,
+  [';'] = 2, ['('] = 2, [')'] = 2, ['#'] = 2,
+#ifdef BRACKET_LISTS
+  ['['] = 2, [']'] = 2,
+#endif
+#ifdef MAKE_TABLE
+  ['{'] = 2, ['}'] = 2,
+#endif
+};
+
+/* EOF is not a space but is a terminator. */
+#define READ_SPACEQ(C) (read_char_class[(unsigned char) (C)] & READ_CC_SPACE)
+#define READ_TERMINATORQ(C) ((C) == EOF || (read_char_class[(unsigned char) (C)] & READ_CC_TERMINATOR))
+
+#else
+#define READ_SPACEQ(C) isspace(C)
+#endif
+
+static
+int eat_whitespace_peekchar(VALUE stream)
+{ READ_STATE
+  int c;
+
+ more_whitespace:
+  while ( (c = PEEKC(stream)) != EOF && READ_SPACEQ(c) ) {
+    if ( READ_DEBUG > 1 ) {
+      fprintf(stderr, "  read: eat_whitespace_peekchar(): whitespace '%c'\n", (int) c);
+      fflush(stderr);
+    }
+    READ_GETC(stream);
+  }
+  if ( c == ';' ) {
+    if ( READ_DEBUG > 0 ) {
+      fprintf(stderr, "  read: eat_whitespace_peekchar(): comment start '%c'\n", (int) c);
+      fflush(stderr);
+    }
+    while ( (c = PEEKC(stream)) != EOF && c != '\n' ) {
+      if ( READ_DEBUG > 1 ) {
+	fprintf(stderr, "  read: eat_whitespace_peekchar(): comment in '%c'\n", (int) c);
+	fflush(stderr);
+      }
+      READ_GETC(stream);
+    }
+    goto more_whitespace;
+  }
+
+  if ( READ_DEBUG > 0 ) {
+    fprintf(stderr, "  read: eat_whitespace_peekchar(): done '%c'\n", (int) c);
+    fflush(stderr);
+  }
+
+  return(c);
+}
+
+#ifndef RETURN
+#define RETURN(X) return (X)
+#endif
+
+#ifndef HASH_VALUE
+#define HASH_VALUE(X) ((unsigned long) (size_t) (X))
+#endif
+
+#ifndef ESCAPE_STRING
+#define ESCAPE_STRING(X) X
+#endif
+
+#ifndef MALLOC
+#define MALLOC(S) malloc(S)
+#endif
+
+#ifndef REALLOC
+#define REALLOC(P,S) realloc(P,S)
+#endif
+
+#ifndef FREE
+#define FREE(P) free(P)
+#endif
+
+#ifdef READ_HASH_CONS
+#ifndef READ_STRING_CACHE
+#define READ_STRING_CACHE 1
+#endif
+#endif
+
+#if defined(READ_HASH_CONS) || defined(READ_SYMBOL_TABLE)
+#define READ_TOKEN_HASH 1
+#endif
+
+#if defined(READ_STRING_CACHE) || defined(READ_TOKEN_HASH)
+
+/* FNV-1a, one byte at a time as it is scanned. */
+#define READ_HASH_INIT 0xcbf29ce484222325UL
+#define READ_HASH_STEP(H,C) (((H) ^ (unsigned char) (C)) * 0x100000001b3UL)
+
+#ifdef READ_HASH_CONS
+static
+unsigned long read_hash_mix(unsigned long h, unsigned long x)
+{
+  h ^= x;
+  h *= 0x100000001b3UL;
+  return h ^ (h >> 29);
+}
+#endif
+
+#endif
+
+#ifdef READ_STRING_CACHE
+
+#ifndef READ_STRING_CACHE_SIZE
+#define READ_STRING_CACHE_SIZE 1024
+#endif
+
+#ifndef READ_STRING_CACHE_STRING_MAX
+#define READ_STRING_CACHE_STRING_MAX 64
+#endif
+
+#define STRING_CACHE_WAYS 4
+
+static struct string_cache_entry {
+  unsigned long hash;
+  char *str;        /* A MALLOCed copy of the raw bytes, or 0 if empty. */
+  size_t len;
+  VALUE v;
+} string_cache[READ_STRING_CACHE_SIZE];
+
+static unsigned long string_cache_hits, string_cache_misses;
+
+/* For the host to call, so inline: a host that does not is not warned. */
+static inline
+void string_cache_clear(void)
+{
+  size_t i;
+  for ( i = 0; i < READ_STRING_CACHE_SIZE; ++ i ) {
+    if ( string_cache[i].str ) {
+      FREE(string_cache[i].str);
+      string_cache[i].str = 0;
+    }
+  }
+}
+
+static
+struct string_cache_entry *string_cache_bucket(unsigned long h)
+{
+  return &string_cache[(h & (READ_STRING_CACHE_SIZE / STRING_CACHE_WAYS - 1)) * STRING_CACHE_WAYS];
+}
+
+/* H is the READ_HASH_STEP() hash of the LEN bytes in BUF. */
+static
+int string_cache_get(unsigned long h, const char *buf, size_t len, VALUE *vp)
+{
+  struct string_cache_entry *e;
+  int i;
+
+  if ( len > READ_STRING_CACHE_STRING_MAX )
+    return 0;
+  e = string_cache_bucket(h);
+  for ( i = 0; i < STRING_CACHE_WAYS; ++ i, ++ e ) {
+    if ( e->str && e->hash == h && e->len == len && memcmp(e->str, buf, len) == 0 ) {
+      ++ string_cache_hits;
+      *vp = e->v;
+      return 1;
+    }
+  }
+  ++ string_cache_misses;
+  return 0;
+}
+
+static
+VALUE string_cache_put(unsigned long h, const char *buf, size_t len, VALUE v)
+{
+  struct string_cache_entry *e;
+
+  if ( len > READ_STRING_CACHE_STRING_MAX )
+    return v;
+  e = string_cache_bucket(h);
+  if ( e[STRING_CACHE_WAYS - 1].str )
+    FREE(e[STRING_CACHE_WAYS - 1].str);
+  memmove(&e[1], &e[0], sizeof(e[0]) * (STRING_CACHE_WAYS - 1));
+  e->hash = h;
+  e->str = memcpy(MALLOC(len + 1), buf, len);
+  e->len = len;
+  e->v = v;
+  return v;
+}
+
+#endif
+
+#ifdef READ_HASH_CONS
+
+#ifndef READ_HASH_CONS_SIZE
+#define READ_HASH_CONS_SIZE 4096
+#endif
+
+#ifndef READ_HASH_CONS_STRING_MAX
+#define READ_HASH_CONS_STRING_MAX 64
+#endif
+
+#define HASH_CONS_WAYS 4
+
+enum {
+  HASH_CONS_EMPTY,
+  HASH_CONS_CONS,
+  HASH_CONS_VECTOR,
+  HASH_CONS_TOKEN,
+  HASH_CONS_RADIX_TOKEN,
+};
+
+static struct hash_cons_entry {
+  unsigned long hash;
+  int kind;
+  VALUE a, d;       /* CONS: car and cdr, VECTOR: list. */
+  char *str;        /* TOKEN: a MALLOCed copy of the bytes. */
+  size_t len;
+  VALUE v;
+} hash_cons_table[READ_HASH_CONS_SIZE];
+
+static
+void hash_cons_evict(struct hash_cons_entry *e)
+{
+  if ( e->str ) {
+    FREE(e->str);
+    e->str = 0;
+  }
+  e->kind = HASH_CONS_EMPTY;
+}
+
+static inline
+void hash_cons_clear(void)
+{
+  size_t i;
+  for ( i = 0; i < READ_HASH_CONS_SIZE; ++ i )
+    hash_cons_evict(&hash_cons_table[i]);
+}
+
+static
+struct hash_cons_entry *hash_cons_bucket(unsigned long h)
+{
+  return &hash_cons_table[(h & (READ_HASH_CONS_SIZE / HASH_CONS_WAYS - 1)) * HASH_CONS_WAYS];
+}
+
+/* Evicts the oldest entry of the bucket and returns a fresh one at its front. */
+static
+struct hash_cons_entry *hash_cons_insert(unsigned long h)
+{
+  struct hash_cons_entry *e = hash_cons_bucket(h);
+  hash_cons_evict(&e[HASH_CONS_WAYS - 1]);
+  memmove(&e[1], &e[0], sizeof(e[0]) * (HASH_CONS_WAYS - 1));
+  e->hash = h;
+  e->str = 0;
+  e->len = 0;
+  return e;
+}
+
+static
+VALUE hash_cons_values(int kind, VALUE a, VALUE d, VALUE (*make)(VALUE, VALUE))
+{
+  unsigned long h = read_hash_mix(read_hash_mix(kind, HASH_VALUE(a)), HASH_VALUE(d));
+  struct hash_cons_entry *e = hash_cons_bucket(h);
+  VALUE v;
+  int i;
+
+  for ( i = 0; i < HASH_CONS_WAYS; ++ i, ++ e ) {
+    if ( e->kind == kind && e->hash == h && EQ(e->a, a) && EQ(e->d, d) )
+      return e->v;
+  }
+  v = make(a, d);
+  e = hash_cons_insert(h);
+  e->a = a;
+  e->d = d;
+  e->v = v;
+  e->kind = kind;
+  return v;
+}
+
+static VALUE hash_cons_make_cons(VALUE a, VALUE d) { return CONS(a, d); }
+static VALUE hash_cons_make_vector(VALUE l, VALUE d) { (void) d; return LIST_2_VECTOR(l); }
+
+#define READ_CONS(X,Y) hash_cons_values(HASH_CONS_CONS, (X), (Y), hash_cons_make_cons)
+#define READ_LIST_2_VECTOR(X) hash_cons_values(HASH_CONS_VECTOR, (X), NIL, hash_cons_make_vector)
+
+/* H is the READ_HASH_STEP() hash of the LEN bytes in BUF. */
+static
+int hash_cons_bytes_get(int kind, unsigned long h, const char *buf, size_t len, VALUE *vp)
+{
+  struct hash_cons_entry *e;
+  int i;
+
+  if ( len > READ_HASH_CONS_STRING_MAX )
+    return 0;
+  e = hash_cons_bucket(read_hash_mix(h, kind));
+  for ( i = 0; i < HASH_CONS_WAYS; ++ i, ++ e ) {
+    if ( e->kind == kind && e->hash == h && e->len == len && memcmp(e->str, buf, len) == 0 ) {
+      *vp = e->v;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static
+VALUE hash_cons_bytes_put(int kind, unsigned long h, const char *buf, size_t len, VALUE v)
+{
+  struct hash_cons_entry *e;
+
+  if ( len > READ_HASH_CONS_STRING_MAX )
+    return v;
+  e = hash_cons_insert(read_hash_mix(h, kind));
+  e->hash = h;
+  e->str = memcpy(MALLOC(len + 1), buf, len);
+  e->len = len;
+  e->v = v;
+  e->kind = kind;
+  return v;
+}
+
+#else
+
+#define READ_CONS(X,Y) CONS(X,Y)
+#define READ_LIST_2_VECTOR(X) LIST_2_VECTOR(X)
+
+#endif
+
+#ifdef READ_SYMBOL_TABLE
+
+#ifndef READ_SYMBOL_MAX
+#define READ_SYMBOL_MAX 65536
+#endif
+
+#ifndef MAKE_SYMBOL
+#define MAKE_SYMBOL(X) STRING_2_SYMBOL(X)
+#endif
+
+#ifndef MAKE_UNINTERNED_SYMBOL
+#define MAKE_UNINTERNED_SYMBOL(X) (X)
+#endif
+
+#define SYMBOL_EPOCH_PERMANENT (~0UL)
+
+struct symbol_entry {
+  struct symbol_entry *next;
+  unsigned long hash;
+  unsigned long epoch;  /* Last epoch read in, or SYMBOL_EPOCH_PERMANENT. */
+  VALUE v;
+  size_t len;
+  char name[1];
+};
+
+static struct symbol_entry **symbol_table;
+static size_t symbol_table_size, symbol_table_n;
+static size_t symbol_table_max = READ_SYMBOL_MAX;
+static unsigned long symbol_table_epoch;
+static unsigned long symbol_table_uninterned;
+
+static
+void symbol_table_grow(void)
+{
+  size_t size = symbol_table_size ? symbol_table_size * 2 : 64, i;
+  struct symbol_entry **table = memset(MALLOC(size * sizeof(table[0])), 0, size * sizeof(table[0]));
+
+  for ( i = 0; i < symbol_table_size; ++ i ) {
+    struct symbol_entry *e, *next;
+    for ( e = symbol_table[i]; e; e = next ) {
+      next = e->next;
+      e->next = table[e->hash & (size - 1)];
+      table[e->hash & (size - 1)] = e;
+    }
+  }
+  if ( symbol_table )
+    FREE(symbol_table);
+  symbol_table = table;
+  symbol_table_size = size;
+}
+
+static
+struct symbol_entry *symbol_table_find(unsigned long h, const char *name, size_t len)
+{
+  struct symbol_entry *e;
+
+  if ( ! symbol_table )
+    return 0;
+  for ( e = symbol_table[h & (symbol_table_size - 1)]; e; e = e->next ) {
+    if ( e->hash == h && e->len == len && memcmp(e->name, name, len) == 0 )
+      return e;
+  }
+  return 0;
+}
+
+static
+VALUE symbol_table_add(unsigned long h, const char *name, size_t len, VALUE v, unsigned long epoch)
+{
+  struct symbol_entry *e;
+
+  if ( symbol_table_n >= symbol_table_size )
+    symbol_table_grow();
+  e = MALLOC(sizeof(*e) + len);
+  memcpy(e->name, name, len);
+  e->name[len] = '\0';
+  e->len = len;
+  e->hash = h;
+  e->epoch = epoch;
+  e->v = v;
+  e->next = symbol_table[h & (symbol_table_size - 1)];
+  symbol_table[h & (symbol_table_size - 1)] = e;
+  ++ symbol_table_n;
+  return v;
+}
+
+/* Interns NAME regardless of symbol_table_max. */
+static
+VALUE symbol_table_intern(const char *name, size_t len, int permanent)
+{ READ_STATE
+  unsigned long h = READ_HASH_INIT;
+  size_t i;
+  struct symbol_entry *e;
+
+  for ( i = 0; i < len; ++ i )
+    h = READ_HASH_STEP(h, name[i]);
+  if ( (e = symbol_table_find(h, name, len)) ) {
+    if ( permanent )
+      e->epoch = SYMBOL_EPOCH_PERMANENT;
+    else if ( e->epoch != SYMBOL_EPOCH_PERMANENT )
+      e->epoch = symbol_table_epoch;
+    return e->v;
+  }
+  {
+    char *buf = memcpy(MALLOC(len + 1), name, len + 1);
+    VALUE v = MAKE_SYMBOL(STRING(buf, len));
+#ifdef STRING_COPIES
+    FREE(buf);
+#endif
+    return symbol_table_add(h, name, len, v,
+			    permanent ? SYMBOL_EPOCH_PERMANENT : symbol_table_epoch);
+  }
+}
+
+/* H is the READ_HASH_STEP() hash of the token, S its string VALUE. */
+static
+VALUE symbol_table_token(unsigned long h, const char *buf, size_t len, VALUE s)
+{ READ_STATE
+  struct symbol_entry *e = symbol_table_find(h, buf, len);
+
+  if ( e ) {
+    if ( e->epoch != SYMBOL_EPOCH_PERMANENT )
+      e->epoch = symbol_table_epoch;
+    return e->v;
+  }
+  if ( symbol_table_n >= symbol_table_max ) {
+    ++ symbol_table_uninterned;
+    return MAKE_UNINTERNED_SYMBOL(s);
+  }
+  return symbol_table_add(h, buf, len, MAKE_SYMBOL(s), symbol_table_epoch);
+}
+
+/* Removes entries last read before EPOCH; returns the number removed. */
+static
+size_t symbol_table_reclaim(unsigned long epoch)
+{
+  size_t i, n = 0;
+
+  for ( i = 0; i < symbol_table_size; ++ i ) {
+    struct symbol_entry **ep = &symbol_table[i], *e;
+    while ( (e = *ep) ) {
+      if ( e->epoch < epoch
+#ifdef SYMBOL_LIVEQ
+	   && ! SYMBOL_LIVEQ(e->v)
+#endif
+	   ) {
+	*ep = e->next;
+	FREE(e);
+	++ n;
+      } else {
+	ep = &e->next;
+      }
+    }
+  }
+  symbol_table_n -= n;
+#ifdef READ_HASH_CONS
+  /* Interned tokens may refer to removed symbols. */
+  if ( n )
+    hash_cons_clear();
+#endif
+  return n;
+}
+
+#endif
+
+/* Builds a list front to back.
+   With READ_HASH_CONS or MAKE_LIST the elements are kept until the end,
+   so the list can be interned back to front or made at once. */
+struct read_list {
+  VALUE l, lc;
+#ifdef READ_LIST_ITEMS
+  struct read_ctx *ctx;         /* Owns items once they are MALLOCed. */
+  VALUE *items;
+  size_t items_n, items_size;
+  VALUE items_buf[16];
+#endif
+};
+
+#ifdef READ_LIST_ITEMS
+
+/* Returns the index of ITEMS in CTX->list_items; the innermost list is last. */
+static
+size_t read_list_items_find(struct read_ctx *ctx, VALUE *items)
+{
+  size_t i = ctx->list_items_n;
+  while ( ctx->list_items[-- i] != items )
+    ;
+  return i;
+}
+
+static
+void read_list_items_free(struct read_ctx *ctx, VALUE *items)
+{
+  size_t i = read_list_items_find(ctx, items);
+  memmove(ctx->list_items + i, ctx->list_items + i + 1, (-- ctx->list_items_n - i) * sizeof(VALUE*));
+  FREE(items);
+}
+
+#endif
+
+/* The items of an unfinished list are freed by read_ctx_reset(CTX). */
+static
+void read_list_init(struct read_list *b, struct read_ctx *ctx)
+{
+  SET(b->l, NIL);
+  SET(b->lc, NIL);
+#ifdef READ_LIST_ITEMS
+  b->ctx = ctx;
+  b->items = b->items_buf;
+  b->items_n = 0;
+  b->items_size = sizeof(b->items_buf) / sizeof(b->items_buf[0]);
+#else
+  (void) ctx;
+#endif
+}
+
+static
+int read_list_emptyQ(struct read_list *b)
+{
+#ifdef READ_LIST_ITEMS
+  return b->items_n == 0;
+#else
+  return EQ(b->lc, NIL);
+#endif
+}
+
+static
+void read_list_add(struct read_list *b, VALUE x)
+{
+#ifdef READ_LIST_ITEMS
+  if ( b->items_n >= b->items_size ) {
+    struct read_ctx *ctx = b->ctx;
+    size_t size = b->items_size * 2;
+    if ( b->items == b->items_buf ) {
+      if ( ctx->list_items_n >= ctx->list_items_size ) {
+        ctx->list_items_size = ctx->list_items_size ? ctx->list_items_size * 2 : 8;
+        ctx->list_items = ctx->list_items ?
+          REALLOC(ctx->list_items, ctx->list_items_size * sizeof(VALUE*)) :
+          MALLOC(ctx->list_items_size * sizeof(VALUE*));
+      }
+      b->items = memcpy(MALLOC(size * sizeof(VALUE)), b->items_buf, sizeof(b->items_buf));
+      ctx->list_items[ctx->list_items_n ++] = b->items;
+    } else {
+      size_t i = read_list_items_find(ctx, b->items);
+      b->items = ctx->list_items[i] = REALLOC(b->items, size * sizeof(VALUE));
+    }
+    b->items_size = size;
+  }
+  b->items[b->items_n ++] = x;
+#else
+  VALUE y = CONS(x, NIL);
+  if ( EQ(b->lc, NIL) ) {
+    SET(b->l, y);
+  } else {
+    SET_CDR(b->lc, y);
+  }
+  SET(b->lc, y);
+#endif
+}
+
+static
+void read_list_set_tail(struct read_list *b, VALUE x)
+{
+#ifdef READ_LIST_ITEMS
+  SET(b->l, x);
+#else
+  SET_CDR(b->lc, x);
+#endif
+}
+
+static
+VALUE read_list_end(struct read_list *b)
+{
+#ifdef READ_LIST_ITEMS
+#if defined(MAKE_LIST) && ! defined(READ_HASH_CONS)
+  if ( b->items_n > 0 )
+    SET(b->l, MAKE_LIST(b->items, b->items_n, b->l));
+#else
+  while ( b->items_n > 0 )
+    SET(b->l, READ_CONS(b->items[-- b->items_n], b->l));
+#endif
+  if ( b->items != b->items_buf )
+    read_list_items_free(b->ctx, b->items);
+#endif
+  return b->l;
+}
+
+#ifdef READ_YIELD
+
+/* Moves list builder FROM to TO, which may be in a different frame. */
+static
+void read_list_move(struct read_list *to, struct read_list *from)
+{
+  *to = *from;
+#ifdef READ_LIST_ITEMS
+  if ( from->items == from->items_buf )
+    to->items = to->items_buf;
+#endif
+}
+
+enum {
+  READ_FRAME_QUOTE,     /* terminator is the quote char, '@' for ",@". */
+  READ_FRAME_LIST,
+  READ_FRAME_LIST_TAIL, /* After '.'. */
+  READ_FRAME_VECTOR,
+  READ_FRAME_SKIP,      /* After "#;". */
+  READ_FRAME_LABEL,     /* After "#n=". */
+};
+
+/* What a READ_DECL call was doing when a READ_CALL() under it yielded. */
+struct read_frame {
+  int kind;
+  int terminator;
+  unsigned long n;
+  struct read_list b;
+};
+
+/* Returns the frame to save the state of the current depth in. */
+static
+struct read_frame *read_frame_push(struct read_ctx *ctx, int kind)
+{
+  size_t d = ctx->depth;
+  if ( d > ctx->frames_size ) {
+    struct read_frame *old = ctx->frames;
+    size_t i, size = ctx->frames_size ? ctx->frames_size * 2 : 16;
+    while ( size < d )
+      size *= 2;
+    ctx->frames = MALLOC(size * sizeof(*old));
+    for ( i = 0; i < ctx->frames_n; ++ i ) {
+      ctx->frames[i] = old[i];
+      read_list_move(&ctx->frames[i].b, &old[i].b);
+    }
+    if ( old )
+      FREE(old);
+    ctx->frames_size = size;
+  }
+  /* The deepest frame is pushed first. */
+  if ( d > ctx->frames_n )
+    ctx->frames_n = d;
+  ctx->frames[d - 1].kind = kind;
+  return &ctx->frames[d - 1];
+}
+
+static
+void read_frames_clear(struct read_ctx *ctx)
+{
+#ifdef READ_LIST_ITEMS
+  size_t i;
+  for ( i = 0; i < ctx->frames_n; ++ i ) {
+    struct read_frame *f = &ctx->frames[i];
+    if ( (f->kind == READ_FRAME_LIST || f->kind == READ_FRAME_LIST_TAIL) && f->b.items != f->b.items_buf )
+      read_list_items_free(ctx, f->b.items);
+  }
+#endif
+  ctx->frames_n = 0;
+}
+
+#ifndef READ_YIELD_CLOCK_BYTES
+#define READ_YIELD_CLOCK_BYTES 4096
+#endif
+
+/* Returns non-zero if the current slice of CTX has used its budget. */
+static
+int read_slice_overQ(struct read_ctx *ctx)
+{
+  if ( ctx->budget && ctx->bytes - ctx->slice_start >= ctx->budget )
+    return 1;
+#ifdef READ_CLOCK
+  if ( ctx->deadline && ctx->bytes - ctx->clock_bytes >= READ_YIELD_CLOCK_BYTES ) {
+    ctx->clock_bytes = ctx->bytes;
+    if ( (unsigned long) READ_CLOCK() >= ctx->deadline )
+      return 1;
+  }
+#endif
+  return 0;
+}
+
+#endif
+
+static int macro_terminating_charQ(int c)
+{
+#ifdef READ_COMPUTED_GOTO
+  return READ_TERMINATORQ(c);
+#endif
+  return c == EOF || c == ';' || c == '(' || c == ')'
+#ifdef BRACKET_LISTS
+    || c == '[' || c == ']'
+#endif
+#ifdef MAKE_TABLE
+    || c == '{' || c == '}'
+#endif
+    || c == '#' || isspace(c);
+}
+
+/* Returns the code point of the hex digits at P, or -1 if they are not
+   one. */
+static
+long read_char_hex(const char *p, size_t len)
+{
+  unsigned long c = 0;
+  size_t i;
+
+  if ( len == 0 || len > 8 )
+    return -1;
+  for ( i = 0; i < len; ++ i ) {
+    if ( ! isxdigit((unsigned char) p[i]) )
+      return -1;
+    c = c * 16 + (isdigit((unsigned char) p[i]) ? p[i] - '0' : (tolower((unsigned char) p[i]) - 'a' + 10));
+  }
+  if ( c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff) )
+    return -1;
+  return c;
+}
+
+/* The R7RS character names, at read_char_name_hash() of each. */
+static const struct read_char_name {
+  const char *name;
+  char c;
+} read_char_names[16] = {
+  [14] = { "alarm", '\a' }, [13] = { "backspace", '\b' }, [4] = { "delete", 0x7f },
+  [1] = { "escape", 0x1b }, [15] = { "newline", '\n' }, [12] = { "null", '\0' },
+  [2] = { "return", '\r' }, [8] = { "space", ' ' }, [9] = { "tab", '\t' },
+};
+
+/* A perfect hash of the names above, for LEN >= 2 letters at P in any case. */
+#define read_char_name_hash(P,LEN) ((((P)[0] | 0x20) + (((P)[1] | 0x20) << 1) + (LEN)) % 16)
+
+/* Returns the character named by the LEN >= 2 letters at P, or -1. */
+static
+int read_char_name(const char *p, size_t len)
+{
+  const struct read_char_name *n = &read_char_names[read_char_name_hash(p, len)];
+  return n->name && strcasecmp(p, n->name) == 0 ? (unsigned char) n->c : -1;
+}
+
+#ifdef READ_UTF8
+
+/* Returns the length of the UTF-8 sequence at P, of at most LEN bytes,
+   and its code point in *CP, or 0 if there is none. */
+static
+size_t read_utf8_decode(const unsigned char *p, size_t len, unsigned long *cp)
+{
+  unsigned long c;
+  size_t n, i;
+
+  if ( len == 0 )
+    return 0;
+  if ( (c = p[0]) < 0x80 ) {
+    *cp = c;
+    return 1;
+  }
+  n = c < 0xc2 ? 0 : c < 0xe0 ? 2 : c < 0xf0 ? 3 : c < 0xf5 ? 4 : 0;
+  if ( n == 0 || len < n )
+    return 0;
+  c &= 0x3f >> (n - 1);
+  for ( i = 1; i < n; ++ i ) {
+    if ( (p[i] & 0xc0) != 0x80 )
+      return 0;
+    c = c << 6 | (p[i] & 0x3f);
+  }
+  if ( (n == 3 && c < 0x800) || (n == 4 && c < 0x10000) || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff) )
+    return 0;
+  *cp = c;
+  return n;
+}
+
+/* Returns non-zero if the LEN bytes at S are UTF-8.
+   Runs of ASCII are skipped a word at a time. */
+static
+int read_utf8_validQ(const char *s, size_t len)
+{
+  const unsigned char *p = (const unsigned char *) s, *end = p + len;
+  unsigned long w, cp;
+  size_t n;
+
+  while ( p < end ) {
+    while ( (size_t) (end - p) >= sizeof(w) ) {
+      memcpy(&w, p, sizeof(w));
+      if ( w & (~0UL / 0xff * 0x80) )
+        break;
+      p += sizeof(w);
+    }
+    while ( p < end && *p < 0x80 )
+      ++ p;
+    if ( p < end ) {
+      if ( ! (n = read_utf8_decode(p, end - p, &cp)) )
+        return 0;
+      p += n;
+    }
+  }
+  return 1;
+}
+
+/* Stores the UTF-8 bytes of code point C at P; returns their number. */
+static
+size_t read_utf8_encode(char *p, unsigned long c)
+{
+  if ( c < 0x80 ) {
+    p[0] = c;
+    return 1;
+  }
+  if ( c < 0x800 ) {
+    p[0] = 0xc0 | c >> 6;
+    p[1] = 0x80 | (c & 0x3f);
+    return 2;
+  }
+  if ( c < 0x10000 ) {
+    p[0] = 0xe0 | c >> 12;
+    p[1] = 0x80 | (c >> 6 & 0x3f);
+    p[2] = 0x80 | (c & 0x3f);
+    return 3;
+  }
+  p[0] = 0xf0 | c >> 18;
+  p[1] = 0x80 | (c >> 12 & 0x3f);
+  p[2] = 0x80 | (c >> 6 & 0x3f);
+  p[3] = 0x80 | (c & 0x3f);
+  return 4;
+}
+
+#endif
+
+#ifdef READ_MACROS
+
+static
+void read_macros_init(struct read_macros *m)
+{
+  int c;
+  for ( c = 0; c < 256; ++ c ) {
+    m->top[c] = m->hash[c] = 0;
+    m->terminating[c] = macro_terminating_charQ(c);
+  }
+}
+
+/* Makes F the read macro for C; TERMINATING if C ends tokens. */
+static
+void read_macros_set(struct read_macros *m, int c, read_macro_fn f, int terminating)
+{
+  m->top[(unsigned char) c] = f;
+  m->terminating[(unsigned char) c] = terminating;
+}
 
-#ifdef READ_DECL
+/* Makes F the read macro for '#' followed by C. */
+static
+void read_macros_set_hash(struct read_macros *m, int c, read_macro_fn f)
+{
+  m->hash[(unsigned char) c] = f;
+}
 
-#include <ctype.h> /* isspace() */
+static
+int read_macros_terminatingQ(const struct read_macros *m, int c)
+{
+  if ( ! m )
+    return macro_terminating_charQ(c);
+  return c == EOF || m->terminating[(unsigned char) c];
+}
 
-#ifndef SET
-#define SET(X,V) ((X) = (V))
-#endif
+#define READ_TERMINATING_CHARQ(C) read_macros_terminatingQ(READ_CTX->macros, C)
 
-#ifndef PEEKC
-#define PEEKC(stream) \
-  ({ int _pc = GETC(stream); if ( _pc != EOF ) UNGETC(stream, _pc); _pc; })
+#ifdef READ_YIELD
+#define READ_MACRO_NO_YIELD() do { \
+    if ( ! READ_CTX->no_yield_depth ) \
+      READ_CTX->no_yield_depth = READ_CTX->depth; \
+  } while ( 0 )
+#else
+#define READ_MACRO_NO_YIELD() ((void) 0)
 #endif
 
-#ifndef READ_DEBUG
-#ifdef READ_DEBUG_WHITESPACE
-#define READ_DEBUG 1
-#endif
-#endif
+/* Calls the read macro F for C, which was taken from the stream. */
+#define READ_MACRO_CALL(F) do { \
+    READ_MACRO_NO_YIELD(); \
+    if ( (F)(stream, c, &x) ) \
+      READ_RETURN(x); \
+    goto try_again; \
+  } while ( 0 )
 
-#ifndef READ_DEBUG
-#define READ_DEBUG 0
+#else
+#define READ_TERMINATING_CHARQ(C) macro_terminating_charQ(C)
 #endif
 
-#ifndef READ_STATE
-#define READ_STATE
-#endif
 
-#ifndef F
-#define F NIL
-#endif
+#ifdef READ_DATUM_LABELS
 
 static
-int eat_whitespace_peekchar(VALUE stream)
-{ READ_STATE
-  int c;
+void read_labels_clear(struct read_ctx *ctx)
+{
+  int i;
+  for ( i = 0; i < READ_LABELS_SMALL; ++ i )
+    ctx->labels_small[i].state = READ_LABEL_UNUSED;
+  if ( ctx->labels ) {
+    FREE(ctx->labels);
+    ctx->labels = 0;
+  }
+  ctx->labels_size = ctx->labels_n = 0;
+  ctx->labels_used = 0;
+}
 
- more_whitespace:
-  while ( (c = PEEKC(stream)) != EOF && isspace(c) ) {
-    if ( READ_DEBUG > 1 ) {
-      fprintf(stderr, "  read: eat_whitespace_peekchar(): whitespace '%c'\n", (int) c);
-      fflush(stderr);
+static
+struct read_label *read_label_find(struct read_ctx *ctx, unsigned long n, int create)
+{
+  struct read_label *l;
+  size_t i;
+
+  if ( n < READ_LABELS_SMALL )
+    return &ctx->labels_small[n];
+
+  if ( create && ctx->labels_n * 2 >= ctx->labels_size ) {
+    struct read_label *old = ctx->labels;
+    size_t old_size = ctx->labels_size;
+    ctx->labels_size = old_size ? old_size * 2 : 16;
+    ctx->labels = memset(MALLOC(ctx->labels_size * sizeof(*l)), 0, ctx->labels_size * sizeof(*l));
+    for ( i = 0; i < old_size; ++ i ) {
+      if ( old[i].state != READ_LABEL_UNUSED ) {
+	l = read_label_find(ctx, old[i].n, 0);
+	*l = old[i];
+      }
     }
-    GETC(stream);
+    if ( old )
+      FREE(old);
   }
-  if ( c == ';' ) {
-    if ( READ_DEBUG > 0 ) {
-      fprintf(stderr, "  read: eat_whitespace_peekchar(): comment start '%c'\n", (int) c);
-      fflush(stderr);
+  if ( ! ctx->labels )
+    return 0;
+  for ( i = n; ; ++ i ) {
+    l = &ctx->labels[i & (ctx->labels_size - 1)];
+    if ( l->state == READ_LABEL_UNUSED ) {
+      if ( ! create )
+	return l;
+      ++ ctx->labels_n;
+      l->n = n;
+      return l;
     }
-    while ( (c = PEEKC(stream)) != EOF && c != '\n' ) {
-      if ( READ_DEBUG > 1 ) {
-	fprintf(stderr, "  read: eat_whitespace_peekchar(): comment in '%c'\n", (int) c);
-	fflush(stderr);
-      }
-      GETC(stream);
+    if ( l->n == n )
+      return l;
+  }
+}
+
+struct read_patch {
+  VALUE from, to;
+  VALUE *seen;
+  size_t seen_size, seen_n;
+};
+
+/* Returns 1 if X was seen before, otherwise remembers it. */
+static
+int read_patch_seenQ(struct read_patch *p, VALUE x)
+{
+  size_t i;
+
+  if ( p->seen_n * 2 >= p->seen_size ) {
+    VALUE *old = p->seen;
+    size_t old_size = p->seen_size;
+    p->seen_size = old_size ? old_size * 2 : 64;
+    p->seen = MALLOC(p->seen_size * sizeof(VALUE));
+    for ( i = 0; i < p->seen_size; ++ i )
+      p->seen[i] = p->from;
+    p->seen_n = 0;
+    for ( i = 0; i < old_size; ++ i ) {
+      if ( ! EQ(old[i], p->from) )
+	read_patch_seenQ(p, old[i]);
     }
-    goto more_whitespace;
+    if ( old )
+      FREE(old);
   }
+  /* The placeholder is never walked, so it marks empty slots. */
+  for ( i = HASH_VALUE(x) * 0x9e3779b97f4a7c15UL >> 7; ; ++ i ) {
+    VALUE *e = &p->seen[i & (p->seen_size - 1)];
+    if ( EQ(*e, p->from) ) {
+      *e = x;
+      ++ p->seen_n;
+      return 0;
+    }
+    if ( EQ(*e, x) )
+      return 1;
+  }
+}
 
-  if ( READ_DEBUG > 0 ) {
-    fprintf(stderr, "  read: eat_whitespace_peekchar(): done '%c'\n", (int) c);
-    fflush(stderr);
+/* Replaces p->from with p->to in the pairs and vectors reachable from X. */
+static
+void read_patch_walk(struct read_patch *p, VALUE x)
+{
+  while ( 1 ) {
+    if ( PAIRQ(x) ) {
+      VALUE y;
+      if ( read_patch_seenQ(p, x) )
+	return;
+      y = CAR(x);
+      if ( EQ(y, p->from) )
+	SET_CAR(x, p->to);
+      else
+	read_patch_walk(p, y);
+      y = CDR(x);
+      if ( EQ(y, p->from) ) {
+	SET_CDR(x, p->to);
+	return;
+      }
+      x = y;
+      continue;
+    }
+#ifdef VECTORQ
+    if ( VECTORQ(x) ) {
+      size_t i, n = VECTOR_LENGTH(x);
+      if ( read_patch_seenQ(p, x) )
+	return;
+      for ( i = 0; i < n; ++ i ) {
+	VALUE y = VECTOR_REF(x, i);
+	if ( EQ(y, p->from) )
+	  VECTOR_SET(x, i, p->to);
+	else
+	  read_patch_walk(p, y);
+      }
+    }
+#endif
+    return;
   }
+}
 
-  return(c);
+static
+void read_label_patch(VALUE x, VALUE from, VALUE to)
+{
+  struct read_patch p;
+  p.from = from;
+  p.to = to;
+  p.seen = 0;
+  p.seen_size = p.seen_n = 0;
+  read_patch_walk(&p, x);
+  if ( p.seen )
+    FREE(p.seen);
 }
 
-#ifndef RETURN
-#define RETURN(X) return (X)
 #endif
 
-#ifndef ESCAPE_STRING
-#define ESCAPE_STRING(X) X
+/* Inline since a host whose ERROR() returns need not call it. */
+static inline
+void read_ctx_reset(struct read_ctx *ctx)
+{
+  ctx->depth = 0;
+#ifdef READ_LIMITS
+  ctx->allocated = 0;
 #endif
-
-#ifndef MALLOC
-#define MALLOC(S) malloc(S)
+#ifdef READ_YIELD
+  read_frames_clear(ctx);
+  if ( ctx->frames ) {
+    FREE(ctx->frames);
+    ctx->frames = 0;
+  }
+  ctx->frames_size = 0;
+  ctx->no_yield_depth = 0;
+  ctx->cancel = 0;
+#endif
+#ifdef READ_DATUM_LABELS
+  read_labels_clear(ctx);
+#endif
+#ifdef READ_LIST_ITEMS
+  while ( ctx->list_items_n > 0 )
+    FREE(ctx->list_items[-- ctx->list_items_n]);
+  if ( ctx->list_items ) {
+    FREE(ctx->list_items);
+    ctx->list_items = 0;
+  }
+  ctx->list_items_size = 0;
 #endif
+}
 
-#ifndef REALLOC
-#define REALLOC(P,S) realloc(P,S)
+/* Called for every return from READ_DECL. */
+static
+void read_leave(struct read_ctx *ctx)
+{
+  -- ctx->depth;
+#ifdef READ_YIELD
+  if ( ctx->depth < ctx->no_yield_depth )
+    ctx->no_yield_depth = 0;
+  /* Labels live until a yielded datum is resumed and finished. */
+  if ( ctx->frames_n )
+    return;
 #endif
+  if ( ctx->depth == 0 ) {
+#ifdef READ_DATUM_LABELS
+    if ( ctx->labels_used )
+      read_labels_clear(ctx);
+#endif
+  }
+}
 
-#ifndef FREE
-#define FREE(P) free(P)
+#define READ_RETURN(X) do { VALUE _read_x = (X); read_leave(READ_CTX); RETURN(_read_x); } while ( 0 )
+
+#ifdef READ_YIELD
+/* Saves a frame of KIND and returns YIELD if X, from READ_CALL(), is YIELD. */
+#define READ_YIELD_SAVE(X,KIND,TERMINATOR) do { \
+    if ( EQ(X, YIELD) ) { \
+      read_frame_push(READ_CTX, KIND)->terminator = (TERMINATOR); \
+      READ_RETURN(YIELD); \
+    } \
+  } while ( 0 )
+#else
+#define READ_YIELD_SAVE(X,KIND,TERMINATOR) ((void) 0)
 #endif
 
-static int macro_terminating_charQ(int c)
-{
-  return c == EOF || c == ';' || c == '(' || c == ')'
-#ifdef BRACKET_LISTS
-    || c == '[' || c == ']'
+#ifdef MAKE_TYPED_VECTOR
+
+#include <stdint.h>
+#include <stdlib.h> /* strtoll(), strtod() */
+#include <errno.h>
+
+enum typed_vector_kind {
+  TYPED_VECTOR_U8,
+  TYPED_VECTOR_S8,
+  TYPED_VECTOR_U16,
+  TYPED_VECTOR_S16,
+  TYPED_VECTOR_U32,
+  TYPED_VECTOR_S32,
+  TYPED_VECTOR_U64,
+  TYPED_VECTOR_S64,
+  TYPED_VECTOR_F32,
+  TYPED_VECTOR_F64,
+};
+
+static const struct typed_vector_type {
+  char tag; int bits; size_t size;
+  int64_t min; uint64_t max;
+} typed_vector_types[] = {
+  { 'u',  8, 1, 0, UINT8_MAX },
+  { 's',  8, 1, INT8_MIN, INT8_MAX },
+  { 'u', 16, 2, 0, UINT16_MAX },
+  { 's', 16, 2, INT16_MIN, INT16_MAX },
+  { 'u', 32, 4, 0, UINT32_MAX },
+  { 's', 32, 4, INT32_MIN, INT32_MAX },
+  { 'u', 64, 8, 0, UINT64_MAX },
+  { 's', 64, 8, INT64_MIN, INT64_MAX },
+  { 'f', 32, 4, 0, 0 },
+  { 'f', 64, 8, 0, 0 },
+};
+
+/* Reads the rest of #u8(...), etc., after TAG.
+   Elements are converted in a stack buffer and stored packed:
+   no VALUE is created for them. */
+static
+VALUE read_typed_vector(VALUE stream, int tag)
+{ READ_STATE
+  const struct typed_vector_type *type = 0;
+  int kind, bits = 0, c;
+  char tok[64];
+  size_t len, n = 0, size = 16;
+  char *data;
+
+  while ( isdigit(c = PEEKC(stream)) ) {
+    READ_GETC(stream);
+    bits = bits * 10 + c - '0';
+  }
+  for ( kind = 0; kind <= TYPED_VECTOR_F64; ++ kind ) {
+    if ( typed_vector_types[kind].tag == tolower(tag) && typed_vector_types[kind].bits == bits ) {
+      type = &typed_vector_types[kind];
+      break;
+    }
+  }
+  if ( ! type )
+    return ERROR("unknown typed vector '#%c%d'", tag, bits);
+  if ( READ_GETC(stream) != '(' )
+    return ERROR("expected '(' after '#%c%d'", tag, bits);
+
+#ifdef READ_LIMITS
+  {
+    int l;
+    READ_ALLOCATED(size * type->size);
+    if ( (l = read_limit_exceeded(READ_CTX, 0)) >= 0 )
+      return READ_LIMIT_ERROR(l);
+  }
 #endif
-    || c == '#' || isspace(c);
+  data = MALLOC(size * type->size);
+  while ( 1 ) {
+    int radix = 10;
+    char *end;
+
+    c = eat_whitespace_peekchar(stream);
+    if ( c == EOF ) {
+      FREE(data);
+      return ERROR("eos in '#%c%d('", tag, bits);
+    }
+    READ_GETC(stream);
+    if ( c == ')' )
+      break;
+    if ( c == '#' ) {
+      switch ( tolower(c = READ_GETC(stream)) ) {
+      case 'b': radix = 2; break;
+      case 'o': radix = 8; break;
+      case 'd': radix = 10; break;
+      case 'x': radix = 16; break;
+      default:
+	FREE(data);
+	return ERROR("bad sequence in '#%c%d(': #%c", tag, bits, c);
+      }
+      c = READ_GETC(stream);
+    }
+    len = 0;
+    tok[len ++] = c;
+    while ( ! READ_TERMINATING_CHARQ(c = PEEKC(stream)) ) {
+      READ_GETC(stream);
+      if ( len >= sizeof(tok) - 1 ) {
+	FREE(data);
+	return ERROR("number too long in '#%c%d('", tag, bits);
+      }
+      tok[len ++] = c;
+    }
+    tok[len] = '\0';
+
+    if ( n >= size ) {
+#ifdef READ_LIMITS
+      int l;
+      READ_ALLOCATED(size * type->size);
+      if ( (l = read_limit_exceeded(READ_CTX, 0)) >= 0 ) {
+	FREE(data);
+	return READ_LIMIT_ERROR(l);
+      }
+#endif
+      data = REALLOC(data, (size *= 2) * type->size);
+    }
+    errno = 0;
+    if ( tag == 'f' || tag == 'F' ) {
+      double d = strtod(tok, &end);
+      if ( radix != 10 || *end ) {
+	FREE(data);
+	return ERROR("invalid number '%s' in '#%c%d('", tok, tag, bits);
+      }
+      if ( kind == TYPED_VECTOR_F32 )
+	((float*) data)[n ++] = d;
+      else
+	((double*) data)[n ++] = d;
+    } else {
+      int64_t i = 0; uint64_t u = 0;
+      if ( tok[0] == '-' ) {
+	i = strtoll(tok, &end, radix);
+	if ( i < type->min ) errno = ERANGE;
+      } else {
+	u = strtoull(tok, &end, radix);
+	if ( u > type->max ) errno = ERANGE;
+	i = (int64_t) u;
+      }
+      if ( *end || end == tok ) {
+	FREE(data);
+	return ERROR("invalid number '%s' in '#%c%d('", tok, tag, bits);
+      }
+      if ( errno == ERANGE ) {
+	FREE(data);
+	return ERROR("number '%s' out of range in '#%c%d('", tok, tag, bits);
+      }
+      switch ( type->size ) {
+      case 1: ((uint8_t*)  data)[n ++] = i; break;
+      case 2: ((uint16_t*) data)[n ++] = i; break;
+      case 4: ((uint32_t*) data)[n ++] = i; break;
+      default: ((uint64_t*) data)[n ++] = i; break;
+      }
+    }
+  }
+  if ( n < size ) {
+#ifdef READ_LIMITS
+    READ_CTX->allocated -= (size - (n ? n : 1)) * type->size;
+#endif
+    data = REALLOC(data, (n ? n : 1) * type->size);
+  }
+  return MAKE_TYPED_VECTOR(kind, data, n);
 }
 
+#endif
+
 READ_DECL
 { READ_STATE
   int c;
   int radix, skip_radix_char;
+  VALUE x;
+#ifdef READ_YIELD
+  struct read_frame *frame = 0;
+#endif
 
+  ++ READ_CTX->depth;
+#ifdef READ_YIELD
+  if ( READ_CTX->cancel ) {
+    read_frames_clear(READ_CTX);
+    READ_CTX->cancel = 0;
+    READ_RETURN(ERROR("read cancelled"));
+  }
+  if ( READ_CTX->depth == 1 )
+    READ_CTX->slice_start = READ_CTX->clock_bytes = READ_CTX->bytes;
+  if ( (size_t) READ_CTX->depth <= READ_CTX->frames_n ) {
+    frame = &READ_CTX->frames[READ_CTX->depth - 1];
+    if ( (size_t) READ_CTX->depth == READ_CTX->frames_n )
+      READ_CTX->frames_n = 0;
+    switch ( frame->kind ) {
+    case READ_FRAME_QUOTE:
+      switch ( frame->terminator ) {
+      case '\'': goto resume_quote;
+      case '`': goto resume_quasiquote;
+      case ',': goto resume_unquote;
+      default: goto resume_unquote_splicing;
+      }
+    case READ_FRAME_LIST: case READ_FRAME_LIST_TAIL: goto resume_list;
+    case READ_FRAME_VECTOR: goto resume_vector;
+    case READ_FRAME_SKIP: goto resume_skip;
+#ifdef READ_DATUM_LABELS
+    case READ_FRAME_LABEL: goto resume_label;
+#endif
+    }
+  }
+  if ( READ_CTX->depth > 1 && ! READ_CTX->no_yield_depth && read_slice_overQ(READ_CTX) )
+    READ_RETURN(YIELD);
+#endif
+#ifdef READ_LIMITS
+  if ( READ_CTX->depth == 1 ) {
+    READ_CTX->datum_start = READ_CTX->bytes;
+    READ_CTX->allocated = 0;
+  }
+  READ_CHECK_LIMITS();
+#endif
  try_again:
   radix = 10; skip_radix_char = 0;
 #ifdef READ_PROLOGUE
@@ -198,78 +1865,176 @@ READ_DECL
 #endif
   c = eat_whitespace_peekchar(stream);
   if ( c == EOF )
-    RETURN(EOS);
-  GETC(stream);
+    READ_RETURN(EOS);
+  READ_GETC(stream);
+#ifdef READ_MACROS
+  if ( READ_CTX->macros && READ_CTX->macros->top[(unsigned char) c] )
+    READ_MACRO_CALL(READ_CTX->macros->top[(unsigned char) c]);
+#endif
+#ifdef READ_COMPUTED_GOTO
+  {
+    /* Each range below overrides the default entries it covers. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverride-init"
+    static const void *const dispatch[256] = {
+      [0 ... 255] = &&dispatch_default,
+      ['\''] = &&dispatch_quote, ['`'] = &&dispatch_quasiquote, [','] = &&dispatch_unquote,
+      ['('] = &&dispatch_list, ['#'] = &&hash_again, ['"'] = &&dispatch_string,
+#ifdef BRACKET_LISTS
+      ['['] = &&dispatch_bracket_list,
+#endif
+      ['0' ... '9'] = &&read_number, ['a' ... 'z'] = &&read_number, ['A' ... 'Z'] = &&read_number,
+      ['~'] = &&read_number, ['!'] = &&read_number, ['@'] = &&read_number, ['$'] = &&read_number,
+      ['%'] = &&read_number, ['&'] = &&read_number, ['*'] = &&read_number, ['_'] = &&read_number,
+      ['+'] = &&read_number, ['-'] = &&read_number, ['='] = &&read_number, [':'] = &&read_number,
+      ['<'] = &&read_number, ['>'] = &&read_number, ['^'] = &&read_number, ['.'] = &&read_number,
+      ['?'] = &&read_number, ['/'] = &&read_number, ['|'] = &&read_number,
+      [128 ... 255] = &&read_number,
+    };
+#pragma GCC diagnostic pop
+    goto *dispatch[(unsigned char) c];
+  }
+#endif
   switch ( c ) {
     case '\'':
-      RETURN(CONS(SYMBOL(quote), CONS(READ_CALL(), NIL)));
+#ifdef READ_COMPUTED_GOTO
+    dispatch_quote:
+#endif
+#ifdef READ_YIELD
+    resume_quote:
+#endif
+      SET(x, READ_CALL());
+      READ_YIELD_SAVE(x, READ_FRAME_QUOTE, '\'');
+      READ_ALLOCATED(2 * 2 * sizeof(VALUE));
+      READ_RETURN(READ_CONS(SYMBOL(quote), READ_CONS(x, NIL)));
 
     case '`':
-      RETURN(CONS(SYMBOL(quasiquote), CONS(READ_CALL(), NIL)));
+#ifdef READ_COMPUTED_GOTO
+    dispatch_quasiquote:
+#endif
+#ifdef READ_YIELD
+    resume_quasiquote:
+#endif
+      SET(x, READ_CALL());
+      READ_YIELD_SAVE(x, READ_FRAME_QUOTE, '`');
+      READ_ALLOCATED(2 * 2 * sizeof(VALUE));
+      READ_RETURN(READ_CONS(SYMBOL(quasiquote), READ_CONS(x, NIL)));
 
     case ',':
+#ifdef READ_COMPUTED_GOTO
+    dispatch_unquote:
+#endif
       if ( PEEKC(stream) == '@' ) {
-	GETC(stream);
-	RETURN(CONS(SYMBOL(unquote_splicing), CONS(READ_CALL(), NIL)));
+	READ_GETC(stream);
+#ifdef READ_YIELD
+      resume_unquote_splicing:
+#endif
+	SET(x, READ_CALL());
+	READ_YIELD_SAVE(x, READ_FRAME_QUOTE, '@');
+	READ_ALLOCATED(2 * 2 * sizeof(VALUE));
+	READ_RETURN(READ_CONS(SYMBOL(unquote_splicing), READ_CONS(x, NIL)));
       } else {
-	RETURN(CONS(SYMBOL(unquote), CONS(READ_CALL(), NIL)));
+#ifdef READ_YIELD
+      resume_unquote:
+#endif
+	SET(x, READ_CALL());
+	READ_YIELD_SAVE(x, READ_FRAME_QUOTE, ',');
+	READ_ALLOCATED(2 * 2 * sizeof(VALUE));
+	READ_RETURN(READ_CONS(SYMBOL(unquote), READ_CONS(x, NIL)));
       }
       break;
 
 #ifdef BRACKET_LISTS
-    case '[': c = ']'; goto list;
+    case '[':
+#ifdef READ_COMPUTED_GOTO
+    dispatch_bracket_list:
+#endif
+      c = ']'; goto list;
 #endif
-    case '(': c = ')';
+    case '(':
+#ifdef READ_COMPUTED_GOTO
+    dispatch_list:
+#endif
+      c = ')';
 #ifdef BRACKET_LISTS
                             list:
 #endif
       {
       int terminator = c;
-      VALUE l = NIL, lc = NIL;
+      struct read_list b;
+      read_list_init(&b, READ_CTX);
+#ifdef READ_YIELD
+      if ( 0 ) {
+      resume_list:
+        terminator = frame->terminator;
+        read_list_move(&b, &frame->b);
+        if ( frame->kind == READ_FRAME_LIST_TAIL )
+          goto resume_list_tail;
+      }
+#endif
       while ( 1 ) {
-        VALUE x;
         c = eat_whitespace_peekchar(stream);
-        if ( c == EOF ) { RETURN(ERROR("eos in list")); }
+        if ( c == EOF ) { READ_RETURN(ERROR("eos in list")); }
         if ( c == terminator ) {
-	  GETC(stream);
+	  READ_GETC(stream);
           break;
         }
         
         SET(x, READ_CALL());
+#ifdef READ_YIELD
+        if ( EQ(x, YIELD) ) {
+          frame = read_frame_push(READ_CTX, READ_FRAME_LIST);
+          goto yield_list;
+        }
+#endif
         
         if ( EQ(x, SYMBOL_DOT) ) {
-          if ( EQ(lc, NIL) ) {
-            RETURN(ERROR("expected something before '.' in list"));
+          if ( read_list_emptyQ(&b) ) {
+            READ_RETURN(ERROR("expected something before '.' in list"));
           }
 
-          SET_CDR(lc, READ_CALL());
+#ifdef READ_YIELD
+        resume_list_tail:
+#endif
+          SET(x, READ_CALL());
+#ifdef READ_YIELD
+          if ( EQ(x, YIELD) ) {
+            frame = read_frame_push(READ_CTX, READ_FRAME_LIST_TAIL);
+          yield_list:
+            frame->terminator = terminator;
+            read_list_move(&frame->b, &b);
+            READ_RETURN(YIELD);
+          }
+#endif
+          read_list_set_tail(&b, x);
 
           c = eat_whitespace_peekchar(stream);
-          if ( c == EOF ) { RETURN(ERROR("eos in '.' list after cdr")); }
-          GETC(stream);
+          if ( c == EOF ) { READ_RETURN(ERROR("eos in '.' list after cdr")); }
+          READ_GETC(stream);
           if ( c != terminator ) {
-            RETURN(ERROR("expected '%c': found '%c'", terminator, c));
+            READ_RETURN(ERROR("expected '%c': found '%c'", terminator, c));
           }
           break;
         } else {
-          VALUE y = CONS(x, NIL);
-          if ( EQ(lc, NIL) ) {
-            SET(l, y);
-          } else {
-            SET_CDR(lc, y);
-          }
-          SET(lc, y);
+          read_list_add(&b, x);
+          READ_ALLOCATED(2 * sizeof(VALUE));
         }
       }
-      RETURN(l);
+      READ_RETURN(read_list_end(&b));
       }
 
     case '#':
   hash_again:
       c = PEEKC(stream);
+#ifdef READ_MACROS
+      if ( c != EOF && READ_CTX->macros && READ_CTX->macros->hash[(unsigned char) c] ) {
+	READ_GETC(stream);
+	READ_MACRO_CALL(READ_CTX->macros->hash[(unsigned char) c]);
+      }
+#endif
       switch ( c ) {
       case EOF:
-	RETURN(ERROR("eos after '#'"));
+	READ_RETURN(ERROR("eos after '#'"));
 
 	/* #! sh-bang comment till EOL. */
       case '!':
@@ -277,9 +2042,9 @@ READ_DECL
 	fprintf(stderr, "  read: #!\n");
 	fflush(stderr);
 #endif
-	GETC(stream);
+	READ_GETC(stream);
 	while ( (c = PEEKC(stream)) != EOF && c != '\n' ) {
-	  GETC(stream);
+	  READ_GETC(stream);
 	}
     	goto try_again;
 
@@ -287,18 +2052,18 @@ READ_DECL
       case '|':
 	{
 	  int level = 1;
-	  GETC(stream);
-	  while ( level > 0 && (c = GETC(stream)) != EOF ) {
+	  READ_GETC(stream);
+	  while ( level > 0 && (c = READ_GETC(stream)) != EOF ) {
 	    if ( c == '|' && PEEKC(stream) == '#' ) {
-	      GETC(stream);
+	      READ_GETC(stream);
 	      -- level;
 	    } else if ( c == '#' && PEEKC(stream) == '|' ) {
-	      GETC(stream);
+	      READ_GETC(stream);
 	      ++ level;
 	    }
 	  }
 	  if ( level > 0 )
-	    RETURN(ERROR("eos inside #| comment |#"));
+	    READ_RETURN(ERROR("eos inside #| comment |#"));
 	}
 	goto try_again;
 
@@ -308,79 +2073,241 @@ READ_DECL
 	fprintf(stderr, "  read: #;\n");
 	fflush(stderr);
 #endif
-	GETC(stream);
-	READ_CALL();
+	READ_GETC(stream);
+#ifdef READ_YIELD
+      resume_skip:
+#endif
+	SET(x, READ_CALL());
+	READ_YIELD_SAVE(x, READ_FRAME_SKIP, 0);
 	goto try_again;
 
       case '(':
-	RETURN(LIST_2_VECTOR(READ_CALL()));
+#ifdef READ_YIELD
+      resume_vector:
+#endif
+	SET(x, READ_CALL());
+	READ_YIELD_SAVE(x, READ_FRAME_VECTOR, 0);
+	READ_RETURN(READ_LIST_2_VECTOR(x));
         
+#ifdef MAKE_TABLE
+	/* #hash((k . v) ...) and #{k v ...} */
+      case 'h': case '{': {
+	int terminator = c == '{' ? '}' : ')';
+	VALUE t, k, v;
+	READ_GETC(stream);
+	if ( c == 'h' ) {
+	  const char *p;
+	  for ( p = "ash("; *p; ++ p ) {
+	    if ( READ_GETC(stream) != *p )
+	      READ_RETURN(ERROR("expected '#hash('"));
+	  }
+	}
+	SET(t, MAKE_TABLE(TABLE_SIZE_HINT(stream, terminator)));
+#ifdef READ_YIELD
+	/* A table is not resumed, so READ_CALL()s under it do not yield. */
+	if ( ! READ_CTX->no_yield_depth )
+	  READ_CTX->no_yield_depth = READ_CTX->depth;
+#endif
+	while ( 1 ) {
+	  c = eat_whitespace_peekchar(stream);
+	  if ( c == EOF ) { READ_RETURN(ERROR("eos in table")); }
+	  if ( c == terminator ) {
+	    READ_GETC(stream);
+	    break;
+	  }
+	  if ( terminator == ')' ) {
+	    if ( c != '(' )
+	      READ_RETURN(ERROR("expected '(' in '#hash(': found '%c'", c));
+	    READ_GETC(stream);
+	    SET(k, READ_CALL());
+	    if ( ! EQ(READ_CALL(), SYMBOL_DOT) )
+	      READ_RETURN(ERROR("expected '.' in '#hash(' entry"));
+	    SET(v, READ_CALL());
+	    c = eat_whitespace_peekchar(stream);
+	    READ_GETC(stream);
+	    if ( c != ')' )
+	      READ_RETURN(ERROR("expected ')' after '#hash(' entry: found '%c'", c));
+	  } else {
+	    SET(k, READ_CALL());
+	    c = eat_whitespace_peekchar(stream);
+	    if ( c == EOF || c == terminator )
+	      READ_RETURN(ERROR("missing value in '#{'"));
+	    SET(v, READ_CALL());
+	  }
+	  TABLE_PUT(t, k, v);
+	  READ_ALLOCATED(2 * sizeof(VALUE));
+	}
+	READ_RETURN(t);
+      }
+#endif
+
+#ifdef READ_DATUM_LABELS
+	/* #n=DATUM and #n# */
+      case '0': case '1': case '2': case '3': case '4':
+      case '5': case '6': case '7': case '8': case '9': {
+	struct read_label *l;
+	unsigned long n = 0;
+	while ( isdigit(c = PEEKC(stream)) ) {
+	  READ_GETC(stream);
+	  if ( n > (ULONG_MAX - (c - '0')) / 10 )
+	    READ_RETURN(ERROR("label too large after '#%lu'", n));
+	  n = n * 10 + c - '0';
+	}
+	READ_GETC(stream);
+	if ( c == '#' ) {
+	  l = read_label_find(READ_CTX, n, 0);
+	  if ( ! l || l->state == READ_LABEL_UNUSED )
+	    READ_RETURN(ERROR("undefined label '#%lu#'", n));
+	  if ( l->state == READ_LABEL_PENDING && ! l->referenced ) {
+	    SET(l->v, CONS(NIL, NIL));
+	    l->referenced = 1;
+	  }
+	  READ_RETURN(l->v);
+	}
+	if ( c != '=' )
+	  READ_RETURN(ERROR("expected '=' or '#' after '#%lu'", n));
+	l = read_label_find(READ_CTX, n, 1);
+	if ( l->state != READ_LABEL_UNUSED )
+	  READ_RETURN(ERROR("duplicate label '#%lu='", n));
+	l->state = READ_LABEL_PENDING;
+	l->referenced = 0;
+	READ_CTX->labels_used = 1;
+#ifdef READ_YIELD
+	if ( 0 ) {
+	resume_label:
+	  n = frame->n;
+	}
+#endif
+	SET(x, READ_CALL());
+#ifdef READ_YIELD
+	if ( EQ(x, YIELD) ) {
+	  frame = read_frame_push(READ_CTX, READ_FRAME_LABEL);
+	  frame->n = n;
+	  READ_RETURN(YIELD);
+	}
+#endif
+	/* The table may have grown during READ_CALL(). */
+	l = read_label_find(READ_CTX, n, 0);
+	if ( l->referenced ) {
+	  if ( EQ(x, l->v) )
+	    READ_RETURN(ERROR("label '#%lu=' refers only to itself", n));
+	  read_label_patch(x, l->v, x);
+	}
+	l->state = READ_LABEL_DEFINED;
+	SET(l->v, x);
+	READ_RETURN(x);
+      }
+#endif
+
       case '\\': {
-        char *buf; size_t len = 1;
-	GETC(stream);
-        if ( (c = GETC(stream)) == EOF )
-	  RETURN(ERROR("eos after '#\\'"));
-        buf = MALLOC(len + 1); buf[0] = c;
-        if ( isalpha(c) )
-          while ( isalpha(c = PEEKC(stream)) && ! macro_terminating_charQ(c) ) {
-            GETC(stream);
-            buf = REALLOC(buf, len + 2);
-            buf[len ++] = c;
-          }
-        buf[len] = '\0';
-        if ( strcasecmp(buf, "space") == 0 ) c = ' ';
-        else if ( strcasecmp(buf, "newline") == 0 ) c = '\n';
-        else if ( len > 1 ) RETURN(ERROR("unknown char name '#\\%s'", buf));
-        else c = buf[0];
-        FREE(buf);
-	RETURN(MAKE_CHAR(c));
+	/* The character, name or hex code point is read into buf without MALLOC. */
+	char buf[32];
+	size_t len = 1;
+	int hex;
+	long cp;
+	READ_GETC(stream);
+	if ( (c = READ_GETC(stream)) == EOF )
+	  READ_RETURN(ERROR("eos after '#\\'"));
+	buf[0] = c;
+#ifdef READ_UTF8
+	/* #\λ: the rest of the UTF-8 sequence. */
+	if ( c >= 0x80 ) {
+	  unsigned long u;
+	  size_t n = c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+	  while ( len < n && (c = PEEKC(stream)) != EOF && (c & 0xc0) == 0x80 ) {
+	    READ_GETC(stream);
+	    buf[len ++] = c;
+	  }
+	  if ( read_utf8_decode((unsigned char *) buf, len, &u) != len )
+	    READ_RETURN(ERROR("invalid UTF-8 in character"));
+	  READ_RETURN(MAKE_CHAR((int) u));
+	}
+#endif
+	hex = (c == 'x' || c == 'X') && isxdigit(PEEKC(stream));
+	if ( isalpha(c) )
+	  while ( (hex ? isalnum(c = PEEKC(stream)) : isalpha(c = PEEKC(stream))) && ! READ_TERMINATING_CHARQ(c) ) {
+	    if ( len == sizeof(buf) - 1 ) {
+	      buf[len] = '\0';
+	      READ_RETURN(ERROR("unknown char name '#\\%s...'", buf));
+	    }
+	    READ_GETC(stream);
+	    buf[len ++] = c;
+	    READ_CHECK_TOKEN_LENGTH(len);
+	  }
+	buf[len] = '\0';
+	if ( len == 1 )
+	  cp = (unsigned char) buf[0];
+	else if ( hex ) {
+	  if ( (cp = read_char_hex(buf + 1, len - 1)) < 0 )
+	    READ_RETURN(ERROR("bad char '#\\%s'", buf));
+	} else if ( (cp = read_char_name(buf, len)) < 0 )
+	  READ_RETURN(ERROR("unknown char name '#\\%s'", buf));
+	READ_RETURN(MAKE_CHAR((int) cp));
       }
 
       case 'f': case 'F':
-	GETC(stream);
-	RETURN(F);
+	READ_GETC(stream);
+#ifdef MAKE_TYPED_VECTOR
+	if ( isdigit(PEEKC(stream)) )
+	  READ_RETURN(read_typed_vector(stream, c));
+#endif
+	READ_RETURN(F);
 
 #ifdef T
       case 't': case 'T':
-	GETC(stream);
-	RETURN(T);
+	READ_GETC(stream);
+	READ_RETURN(T);
 #endif
         
-#ifdef U
+#if defined(U) || defined(MAKE_TYPED_VECTOR)
       case 'u': case 'U':
-	GETC(stream);
-	RETURN(U);
+	READ_GETC(stream);
+#ifdef MAKE_TYPED_VECTOR
+	if ( isdigit(PEEKC(stream)) )
+	  READ_RETURN(read_typed_vector(stream, c));
+#endif
+#ifdef U
+	READ_RETURN(U);
+#else
+	READ_RETURN(ERROR("bad sequence: #%c", c));
+#endif
+#endif
+
+#ifdef MAKE_TYPED_VECTOR
+      case 's': case 'S':
+	READ_GETC(stream);
+	READ_RETURN(read_typed_vector(stream, c));
 #endif
 
 #ifdef E
       case '#':
-	GETC(stream);
-	RETURN(E);
+	READ_GETC(stream);
+	READ_RETURN(E);
 #endif
 
       case 'e': case 'E':
       case 'i': case 'I':
-        GETC(stream);
+        READ_GETC(stream);
 	goto hash_again;
 
       case 'b': case 'B':
 	skip_radix_char = 1; radix = 2;
-	GETC(stream);
+	READ_GETC(stream);
 	goto read_radix_number;
 	
       case 'o': case 'O':
 	skip_radix_char = 1; radix = 8;
-	GETC(stream);
+	READ_GETC(stream);
 	goto read_radix_number;
 
       case 'd': case 'D':
 	skip_radix_char = 1; radix = 10;
-	GETC(stream);
+	READ_GETC(stream);
 	goto read_radix_number;
 	
       case 'x': case 'X':
 	skip_radix_char = 1; radix = 16;
-	GETC(stream);
+	READ_GETC(stream);
 
       read_radix_number:
         // c = GETC(stream);
@@ -391,39 +2318,120 @@ READ_DECL
 	{
 	  VALUE x;
 
-	  GETC(stream);
+	  READ_GETC(stream);
 	  SET(x, CALL_MACRO_CHAR(c));
 	  if ( EQ(x,F) ) {
 	    goto try_again;
 	  } else {
-	    RETURN(CAR(x));
+	    READ_RETURN(CAR(x));
 	  }
 	}
 #endif
-	RETURN(ERROR("bad sequence: #%c", c));
+	READ_RETURN(ERROR("bad sequence: #%c", c));
       }
       break;
 
-    case '"': {
+    case '"':
+#ifdef READ_COMPUTED_GOTO
+    dispatch_string:
+#endif
+    {
       size_t buflen = 2, len = 0;
       char *buf = MALLOC(buflen += buflen + 1);
-      while ( (c = GETC(stream)) != '"' ) {
+      VALUE x;
+#ifdef READ_STRING_CACHE
+      unsigned long h = READ_HASH_INIT;
+#endif
+#ifdef READ_UTF8
+      int hi = 0;
+#endif
+      while ( (c = READ_GETC(stream)) != '"' ) {
       again:
         if ( c == EOF ) {
-          RETURN(ERROR("EOS in string"));
+          FREE(buf);
+          READ_RETURN(ERROR("EOS in string"));
         }
         if ( buflen <= len )
           buf = REALLOC(buf, buflen += buflen + 1);
         buf[len ++] = c;
+        READ_CHECK_TOKEN(len, buf);
+#ifdef READ_UTF8
+        hi |= c;
+#endif
         
+        /* The string cache hashes the bytes left in buf. */
         if ( c == '\\' ) {
-          c = GETC(stream);
+          c = READ_GETC(stream);
+#ifdef READ_UTF8
+          /* \x3BB; is replaced here; \x5C; stays an escaped '\\'. */
+          if ( c == 'x' || c == 'X' ) {
+            char hex[8];
+            size_t n = 0;
+            long cp;
+            while ( (c = READ_GETC(stream)) != ';' && c != EOF && c != '"' && n < sizeof(hex) )
+              hex[n ++] = c;
+            if ( c != ';' || (cp = read_char_hex(hex, n)) < 0 ) {
+              FREE(buf);
+              READ_RETURN(ERROR("bad \\x escape in string"));
+            }
+            if ( buflen <= len + 4 )
+              buf = REALLOC(buf, buflen += buflen + 4);
+            if ( cp != '\\' )
+              -- len;
+#ifdef READ_STRING_CACHE
+            else
+              h = READ_HASH_STEP(h, '\\');
+#endif
+            n = read_utf8_encode(buf + len, cp);
+#ifdef READ_STRING_CACHE
+            {
+              size_t i;
+              for ( i = 0; i < n; ++ i )
+                h = READ_HASH_STEP(h, buf[len + i]);
+            }
+#endif
+            len += n;
+            READ_CHECK_TOKEN(len, buf);
+            continue;
+          }
+#endif
+#ifdef READ_STRING_CACHE
+          h = READ_HASH_STEP(h, '\\');
+#endif
           goto again;
         }
+#ifdef READ_STRING_CACHE
+        h = READ_HASH_STEP(h, c);
+#endif
+      }
+#ifdef READ_UTF8
+      if ( (hi & 0x80) && ! read_utf8_validQ(buf, len) ) {
+        FREE(buf);
+        READ_RETURN(ERROR("invalid UTF-8 in string"));
+      }
+#endif
+#ifdef READ_STRING_CACHE
+      if ( string_cache_get(h, buf, len, &x) ) {
+        FREE(buf);
+        READ_RETURN(x);
       }
+#endif
+#ifdef STRING_COPIES
+      if ( buflen <= len )
+        buf = REALLOC(buf, len + 1);
+#else
       buf = REALLOC(buf, len + 1);
+#endif
       buf[len] = '\0';
-      RETURN(ESCAPE_STRING(STRING(buf, len)));
+      READ_ALLOCATED(len + 1);
+      x = ESCAPE_STRING(STRING(buf, len));
+#ifdef READ_STRING_CACHE
+      x = string_cache_put(h, buf, len, x);
+#endif
+#ifdef STRING_COPIES
+      FREE(buf);
+#endif
+      READ_RETURN(x);
     }
 
     read_number:
@@ -449,33 +2457,98 @@ READ_DECL
     {
       VALUE s, n;
       char *buf; size_t len = 1;
+#ifdef READ_HASH_CONS
+      int hc_kind;
+#endif
+#ifdef READ_TOKEN_HASH
+      unsigned long hc_hash = READ_HASH_STEP(READ_HASH_INIT, c);
+#endif
+#ifdef READ_UTF8
+      int hi = c;
+#endif
 
       buf = MALLOC(len + 1); buf[0] = c;
-      while ( ! macro_terminating_charQ(c = PEEKC(stream)) ) {
-        GETC(stream);
+      while ( ! READ_TERMINATING_CHARQ(c = PEEKC(stream)) ) {
+        READ_GETC(stream);
         buf = REALLOC(buf, len + 2);
         buf[len ++] = c;
+        READ_CHECK_TOKEN(len, buf);
+#ifdef READ_TOKEN_HASH
+        hc_hash = READ_HASH_STEP(hc_hash, c);
+#endif
+#ifdef READ_UTF8
+        hi |= c;
+#endif
       }
       buf[len] = '\0';
+      READ_ALLOCATED(len + 1);
+#ifdef READ_UTF8
+      if ( (hi & 0x80) && ! read_utf8_validQ(buf, len) ) {
+        FREE(buf);
+        READ_RETURN(ERROR("invalid UTF-8 in token"));
+      }
+#endif
+
+#ifdef KNOWN_SYMBOL
+      if ( ! skip_radix_char ) {
+        int known = KNOWN_SYMBOL(buf, len);
+        if ( known >= 0 ) {
+          FREE(buf);
+          READ_RETURN(KNOWN_SYMBOL_VALUE(known));
+        }
+      }
+#endif
+
+#ifdef READ_HASH_CONS
+      hc_kind = skip_radix_char ? HASH_CONS_RADIX_TOKEN : HASH_CONS_TOKEN;
+      if ( hash_cons_bytes_get(hc_kind, hc_hash, buf, len, &n) ) {
+        FREE(buf);
+        READ_RETURN(n);
+      }
+#endif
 
       s = STRING(buf + skip_radix_char, len - skip_radix_char);
       n = STRING_2_NUMBER(s, radix);
       if ( EQ(n, F) ) {
-        if ( skip_radix_char ) RETURN(ERROR("invalid number string '%s'", buf + skip_radix_char));
+        if ( skip_radix_char ) {
+#ifdef STRING_COPIES
+          char tok[128];
+          size_t n = len - skip_radix_char < sizeof(tok) ? len - skip_radix_char : sizeof(tok) - 1;
+          memcpy(tok, buf + skip_radix_char, n);
+          tok[n] = '\0';
+          FREE(buf);
+          READ_RETURN(ERROR("invalid number string '%s'", tok));
+#else
+          READ_RETURN(ERROR("invalid number string '%s'", buf + skip_radix_char));
+#endif
+        }
+#ifdef READ_SYMBOL_TABLE
+	n = symbol_table_token(hc_hash, buf, len, s);
+#else
 	n = STRING_2_SYMBOL(s);
+#endif
 #ifdef NIL_SYMBOL
         if ( EQ(n, NIL_SYMBOL) ) {
 	  n = NIL;
 	}
 #endif
       }
-      RETURN(n);
+#ifdef READ_HASH_CONS
+      n = hash_cons_bytes_put(hc_kind, hc_hash, buf, len, n);
+#endif
+#ifdef STRING_COPIES
+      FREE(buf);
+#endif
+      READ_RETURN(n);
     }
       break;
 
     default:
+#ifdef READ_COMPUTED_GOTO
+    dispatch_default:
+#endif
       if ( c >= 128 ) goto read_number; // UTF8, 8-bit encoding?
-      RETURN(ERROR("unexpected character '%c'", c));
+      READ_RETURN(ERROR("unexpected character '%c'", c));
   }
 }
 
@@ -483,4 +2556,30 @@ READ_DECL
 READ_DECL_END
 #endif
 
+#ifdef READ_MACROS
+
+/* For read macros: reads datums up to the TERMINATOR char into a list. */
+static
+VALUE read_macro_list(VALUE stream, int terminator)
+{
+  struct read_list b;
+  VALUE x;
+  int c;
+
+  read_list_init(&b, READ_CTX);
+  while ( (c = eat_whitespace_peekchar(stream)) != terminator ) {
+    if ( c == EOF )
+      return ERROR("eos before '%c'", terminator);
+    SET(x, READ_CALL());
+    if ( EQ(x, EOS) )
+      return ERROR("eos before '%c'", terminator);
+    read_list_add(&b, x);
+    READ_ALLOCATED(2 * sizeof(VALUE));
+  }
+  READ_GETC(stream);
+  return read_list_end(&b);
+}
+
+#endif
+
 #endif
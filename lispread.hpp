@@ -0,0 +1,2225 @@
+/*
+** lispread.hpp - a generic lisp reader as a C++ template.
+*/
+/*
+This is lispread.c as a header-only C++ template: lispread::reader<Traits, Input>.
+Instead of macros, a Traits class supplies the value type, its constructors
+and the optional syntax as static members.  Every hook is an inline call and
+syntax that is switched off is removed at compile time, so several
+differently specialised readers can live in one program.
+
+It reads the same syntax as lispread.c without the optional extensions
+(hash-consing, symbol table, typed vectors, tables, datum labels, limits
+and yields), with the same error messages.  Errors throw lispread::error.
+The reader is not reentrant: use one reader per input.
+
+  struct my_traits { ... };
+  lispread::string_input in(text);
+  lispread::reader<my_traits, lispread::string_input> r(in);
+  for ( auto x = r.read(); ! my_traits::eq(x, my_traits::eos()); x = r.read() )
+    ...
+
+Members declared "Opt." are optional.
+
+Traits member                   Implementation
+==========================================================================
+value                           The C++ type for a lisp value.
+nil(), eos(), t(), f()          The empty list, end-of-stream, #t and #f values.
+eq(x, y)                        Return true if (eq? x y).
+cons(a, d)                      Return a new pair.
+make_list(p, n, tail)           Return a list of the n > 0 values at p followed by tail.  Opt.
+                                p is reused after the call.  Defaults to n cons() calls.
+make_char(c)                    Return a character for the C int c.
+list_2_vector(l)                Convert list l into a vector.
+string(s)                       Return a new string with the bytes of string_view s.
+string_2_number(s, radix)       Return the number in string_view s, or f().
+string_2_symbol(s)              Return the symbol named by string_view s.
+symbol(s)                       Return the symbol named by string_view s,
+                                for "quote", etc. and ".".
+
+bracket_lists                   If true, read [...] lists.  Opt.
+unspecified, u()                If true, read #u as u().  Opt.
+logical_eof, e()                If true, read ## as e().  Opt.
+macro_chars, call_macro_char(c, x)  If true, "#C" for an unknown C calls
+                                call_macro_char(), which returns false to
+                                continue scanning or true with the value in x.  Opt.
+
+The Input class gives the reader its bytes a window at a time:
+
+std::string_view peek_window()  Return the next bytes of the input, or an
+                                empty view at the end.  The view is valid
+                                until the next advance().
+void advance(std::size_t n)     Consume the first n bytes of the window.
+
+The reader scans each window directly and only copies a token or string
+that crosses from one window to the next; other tokens and strings are
+passed to the Traits as views into the window.  It calls advance() at the
+end of each read(), so between reads the input is positioned just after
+the datum.  The adapters below are provided:
+
+string_input(sv)                A string_view, which must outlive it.
+iovec_input(iov, n)             A scatter/gather chain of n iovecs.
+mmap_input(path), mmap_input(fd)  A mapped file.
+file_input(fp, size)            A FILE*, read with fread() into a buffer of
+                                size bytes.  fp is read ahead of the reader.
+fd_input(fd, size)              A POSIX file descriptor, read with read(2).
+readahead_input(fd, depth, size)  A file descriptor read in depth buffers
+                                of size bytes at once, ahead of the reader.
+
+mmap_input, iovec_input, fd_input and readahead_input need POSIX.
+
+readahead_input is for files bigger than memory, or on slow or network
+disks, where mmap_input stalls in page faults and fd_input waits for
+each read(2): it keeps depth reads of size bytes (4 of 1MB by default) in
+flight and starts another as soon as the reader has finished a buffer.
+The reads are made by io_uring on Linux when the kernel allows it, or
+else by depth threads calling pread(2); readahead_input(fd, depth, size,
+false) always uses threads, and backend() says which is in use.
+
+With C++20, lispread::datums(in, traits) is an input range of the datums
+of in, which works with the standard range adaptors:
+
+  for ( auto x : lispread::datums(in, my_traits()) | std::views::take(10) )
+    ...
+
+lispread::ct reads a string literal while compiling, into a constant tree
+of cells that needs no reading at run time:
+
+  using namespace lispread::literals;
+  static constexpr auto table = "((alpha 1) (beta 2))"_sexp;
+  table.root().car().car().symbolQ("alpha")
+
+Values are lispread::ct::value; symbols carry symbol_id(name), a hash that
+is the same in every tree and can be a case label.  Only integers are read
+as numbers, and a malformed literal fails to compile at a call to
+malformed_literal("why").
+
+lispread::async_reader<Traits> reads datums in a coroutine:
+"co_await r.next()" suspends until a whole datum has arrived.  Its bytes
+are given by feed() and close(), or on Linux read from a non-blocking fd
+when a lispread::event_loop, a small epoll loop, finds it readable:
+
+  lispread::event_loop loop;
+  lispread::async_reader<my_traits> r(loop, fd);
+  ... in a coroutine:  auto x = co_await r.next();
+  loop.run();
+
+A reader that is destroyed takes its fd off the loop; event_loop::cancel(fd)
+does the same for any fd.
+
+Each byte is scanned once as it arrives, for strings, comments and list
+depth, and a datum is only read once a byte that may end it has come, so
+a datum trickling in a byte at a time costs time linear in its size.
+Only a datum that the scan cannot see is unfinished, as after "#;", is
+read again from its start, so the Traits may see those values twice.  An
+error inside a list is raised once the top-level list has ended, or at
+close().
+
+The reader scans whitespace, strings, tokens and #| comments |# in a
+window with kernels chosen once per process from what the CPU supports:
+on x86, "avx512" (AVX-512BW), "avx2", "sse42" or else "scalar".  A #|
+comment only stops at its '|' and '#' bytes, and ';' and #! comments
+skip to the newline with memchr().  Setting LISPREAD_SIMD to one of these
+names before the first reader is made caps the choice, for benchmarks and
+tests; lispread::simd::use(name) changes it for readers made later.
+Whitespace is the C locale's.
+
+String escapes are replaced by the reader: \n, \t, \r, \a, \b and \0,
+and \C is C for any other C.
+
+Lists are collected on a stack of values inside the reader and built back
+to front when they end; a host with a precise GC must not collect during
+a read.
+
+*/
+
+#ifndef LISPREAD_HPP
+#define LISPREAD_HPP
+
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LISPREAD_POSIX 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LISPREAD_X86 1
+#include <immintrin.h>
+#endif
+
+#ifdef __linux__
+#define LISPREAD_EPOLL 1
+#include <sys/epoll.h>
+#if __has_include(<linux/io_uring.h>)
+#define LISPREAD_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#if __cplusplus >= 202002L
+#include <iterator>
+#include <ranges>
+#endif
+
+#ifdef __cpp_impl_coroutine
+#include <coroutine>
+#include <exception>
+#endif
+
+namespace lispread {
+
+class error : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+/* Reads from a string_view, which must outlive it. */
+class string_input {
+  std::string_view s_;
+public:
+  explicit string_input(std::string_view s) : s_(s) { }
+  std::string_view peek_window() const { return s_; }
+  void advance(std::size_t n) { s_.remove_prefix(n); }
+};
+
+/* Reads a FILE* through a buffer of its own, so the reader never calls
+   getc() and chunks are read with one fread() each. */
+class file_input {
+  std::FILE *fp_;
+  std::unique_ptr<char[]> buf_;
+  std::size_t size_, pos_ = 0, n_ = 0;
+public:
+  explicit file_input(std::FILE *fp, std::size_t size = 64 * 1024) :
+    fp_(fp), buf_(new char[size]), size_(size) { }
+  std::string_view peek_window()
+  {
+    if ( pos_ == n_ ) {
+#if defined(__GLIBC__) && defined(_DEFAULT_SOURCE)
+      n_ = fread_unlocked(buf_.get(), 1, size_, fp_);
+#else
+      n_ = std::fread(buf_.get(), 1, size_, fp_);
+#endif
+      pos_ = 0;
+    }
+    return std::string_view(buf_.get() + pos_, n_ - pos_);
+  }
+  void advance(std::size_t n) { pos_ += n; }
+};
+
+#ifdef LISPREAD_POSIX
+
+/* Reads the iov_len bytes at each iov_base in turn; the iovecs must outlive it. */
+class iovec_input {
+  const struct iovec *iov_, *end_;
+  std::size_t off_ = 0;
+public:
+  iovec_input(const struct iovec *iov, std::size_t n) : iov_(iov), end_(iov + n) { }
+  std::string_view peek_window()
+  {
+    while ( iov_ < end_ && off_ == iov_->iov_len ) {
+      ++ iov_;
+      off_ = 0;
+    }
+    if ( iov_ == end_ )
+      return std::string_view();
+    return std::string_view((const char*) iov_->iov_base + off_, iov_->iov_len - off_);
+  }
+  void advance(std::size_t n) { off_ += n; }
+};
+
+/* Maps a whole file and reads it as one window. */
+class mmap_input {
+  void *map_ = 0;
+  std::string_view s_;
+  void map(int fd)
+  {
+    struct stat st;
+    if ( fstat(fd, &st) < 0 )
+      throw error(std::string("fstat: ") + std::strerror(errno));
+    if ( st.st_size == 0 )
+      return;
+    map_ = mmap(0, (std::size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if ( map_ == MAP_FAILED ) {
+      map_ = 0;
+      throw error(std::string("mmap: ") + std::strerror(errno));
+    }
+    s_ = std::string_view((const char*) map_, (std::size_t) st.st_size);
+  }
+public:
+  explicit mmap_input(int fd) { map(fd); }
+  explicit mmap_input(const char *path)
+  {
+    int fd = open(path, O_RDONLY);
+    if ( fd < 0 )
+      throw error(std::string(path) + ": " + std::strerror(errno));
+    try {
+      map(fd);
+    } catch ( ... ) {
+      close(fd);
+      throw;
+    }
+    close(fd);
+  }
+  mmap_input(const mmap_input &) = delete;
+  mmap_input &operator=(const mmap_input &) = delete;
+  ~mmap_input()
+  {
+    if ( map_ )
+      munmap(map_, s_.size());
+  }
+  std::string_view peek_window() const { return s_; }
+  void advance(std::size_t n) { s_.remove_prefix(n); }
+};
+
+/* Reads a file descriptor with read(2) into a buffer of its own. */
+class fd_input {
+  int fd_;
+  std::unique_ptr<char[]> buf_;
+  std::size_t size_, pos_ = 0, n_ = 0;
+public:
+  explicit fd_input(int fd, std::size_t size = 64 * 1024) :
+    fd_(fd), buf_(new char[size]), size_(size) { }
+  std::string_view peek_window()
+  {
+    if ( pos_ == n_ ) {
+      ssize_t n;
+      while ( (n = ::read(fd_, buf_.get(), size_)) < 0 && errno == EINTR )
+        ;
+      if ( n < 0 )
+        throw error(std::string("read: ") + std::strerror(errno));
+      n_ = (std::size_t) n;
+      pos_ = 0;
+    }
+    return std::string_view(buf_.get() + pos_, n_ - pos_);
+  }
+  void advance(std::size_t n) { pos_ += n; }
+};
+
+#ifdef LISPREAD_IO_URING
+
+/* Just enough of an io_uring to read into buffers: one readv at a time is
+   submitted, and completions are reaped in order of arrival. */
+class uring {
+  int fd_ = -1;
+  void *sq_ = MAP_FAILED, *cq_ = MAP_FAILED;
+  std::size_t sq_size_ = 0, cq_size_ = 0, sqes_size_ = 0;
+  struct io_uring_sqe *sqes_ = (struct io_uring_sqe*) MAP_FAILED;
+  unsigned *sq_tail_, *sq_mask_, *sq_array_, *cq_head_, *cq_tail_, *cq_mask_;
+  struct io_uring_cqe *cqes_;
+
+  static int enter(int fd, unsigned submit, unsigned wait, unsigned flags)
+  {
+    return (int) syscall(__NR_io_uring_enter, fd, submit, wait, flags, (void*) 0, 0);
+  }
+public:
+  uring() = default;
+  uring(const uring &) = delete;
+  uring &operator=(const uring &) = delete;
+  ~uring() { close(); }
+
+  /* Returns false if the kernel has no io_uring or does not allow it. */
+  bool open(unsigned entries)
+  {
+    struct io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    if ( (fd_ = (int) syscall(__NR_io_uring_setup, entries, &p)) < 0 )
+      return false;
+    sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if ( p.features & IORING_FEAT_SINGLE_MMAP )
+      sq_size_ = cq_size_ = sq_size_ > cq_size_ ? sq_size_ : cq_size_;
+    sq_ = mmap(0, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if ( sq_ == MAP_FAILED )
+      return close(), false;
+    if ( p.features & IORING_FEAT_SINGLE_MMAP )
+      cq_ = sq_;
+    else if ( (cq_ = mmap(0, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING)) == MAP_FAILED )
+      return close(), false;
+    sqes_size_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = (struct io_uring_sqe*) mmap(0, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if ( sqes_ == MAP_FAILED )
+      return close(), false;
+    sq_tail_ = (unsigned*) ((char*) sq_ + p.sq_off.tail);
+    sq_mask_ = (unsigned*) ((char*) sq_ + p.sq_off.ring_mask);
+    sq_array_ = (unsigned*) ((char*) sq_ + p.sq_off.array);
+    cq_head_ = (unsigned*) ((char*) cq_ + p.cq_off.head);
+    cq_tail_ = (unsigned*) ((char*) cq_ + p.cq_off.tail);
+    cq_mask_ = (unsigned*) ((char*) cq_ + p.cq_off.ring_mask);
+    cqes_ = (struct io_uring_cqe*) ((char*) cq_ + p.cq_off.cqes);
+    return true;
+  }
+
+  void close()
+  {
+    if ( sqes_ != MAP_FAILED )
+      munmap(sqes_, sqes_size_);
+    if ( cq_ != MAP_FAILED && cq_ != sq_ )
+      munmap(cq_, cq_size_);
+    if ( sq_ != MAP_FAILED )
+      munmap(sq_, sq_size_);
+    if ( fd_ >= 0 )
+      ::close(fd_);
+    fd_ = -1;
+    sq_ = cq_ = MAP_FAILED;
+    sqes_ = (struct io_uring_sqe*) MAP_FAILED;
+  }
+
+  /* Starts reading fd at off into the iovec, which must outlive the read.
+     Returns 0 or an errno. */
+  int readv(int fd, const struct iovec *iov, off_t off, std::uint64_t data)
+  {
+    unsigned tail = *sq_tail_, i = tail & *sq_mask_;
+    struct io_uring_sqe *sqe = &sqes_[i];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = (std::uint64_t) (std::uintptr_t) iov;
+    sqe->len = 1;
+    sqe->off = (std::uint64_t) off;
+    sqe->user_data = data;
+    sq_array_[i] = i;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    while ( enter(fd_, 1, 0, 0) < 0 )
+      if ( errno != EINTR )
+        return errno;
+    return 0;
+  }
+
+  /* Waits for at least one read to complete and calls f(data, res) for each. */
+  template <class F>
+  void reap(F f)
+  {
+    unsigned head = *cq_head_;
+    while ( head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE) )
+      if ( enter(fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR )
+        throw error(std::string("io_uring_enter: ") + std::strerror(errno));
+    do {
+      struct io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+      std::uint64_t data = cqe->user_data;
+      int res = cqe->res;
+      __atomic_store_n(cq_head_, ++ head, __ATOMIC_RELEASE);
+      f(data, res);
+    } while ( head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE) );
+  }
+};
+
+#endif
+
+/* Reads a file descriptor ahead of the reader, for big files and slow
+   disks: depth buffers of size bytes are read at once, and a buffer is
+   read again, depth buffers further on, as soon as the reader is past it.
+   The reads are made with io_uring where the kernel allows it, or else by
+   depth threads calling pread(2).  fd is read from its current offset and
+   must support pread(2).  The buffers are page aligned, so an fd opened
+   with O_DIRECT works if size is a multiple of its block size. */
+class readahead_input {
+  struct slot {
+    char *buf;
+    off_t off = 0;              /* The file offset of buf[0]. */
+    std::size_t n = 0;          /* The bytes read into buf. */
+    int err = 0;
+    bool done = true;
+    struct iovec iov;
+  };
+
+  int fd_;
+  std::size_t depth_, size_, cur_ = 0, pos_ = 0;
+  std::size_t stride_;          /* size_ rounded up to a page. */
+  off_t next_ = 0;              /* The file offset of the next buffer to read. */
+  std::unique_ptr<char, decltype(&std::free)> mem_;
+  std::vector<slot> slots_;
+#ifdef LISPREAD_IO_URING
+  uring ring_;
+  bool uring_ = false;
+#endif
+  std::mutex m_;
+  std::condition_variable work_, done_;
+  std::deque<std::size_t> queue_;
+  std::vector<std::thread> threads_;
+  bool stop_ = false;
+
+#ifdef LISPREAD_IO_URING
+  /* Reads the rest of slot i's buffer. */
+  void submit(std::size_t i)
+  {
+    slot &s = slots_[i];
+    s.iov.iov_base = s.buf + s.n;
+    s.iov.iov_len = size_ - s.n;
+    if ( (s.err = ring_.readv(fd_, &s.iov, s.off + (off_t) s.n, i)) )
+      s.done = true;
+  }
+
+  /* A readv may stop short of the buffer before the end of the file. */
+  void complete(std::size_t i, int res)
+  {
+    slot &s = slots_[i];
+    if ( res == -EINTR || res == -EAGAIN )
+      submit(i);
+    else if ( res < 0 ) {
+      s.err = -res;
+      s.done = true;
+    } else if ( res > 0 && (s.n += (std::size_t) res) < size_ )
+      submit(i);
+    else
+      s.done = true;
+  }
+#endif
+
+  void work()
+  {
+    std::unique_lock<std::mutex> lock(m_);
+    while ( 1 ) {
+      work_.wait(lock, [this] { return stop_ || ! queue_.empty(); });
+      if ( stop_ )
+        return;
+      slot &s = slots_[queue_.front()];
+      queue_.pop_front();
+      lock.unlock();
+      std::size_t n = 0;
+      int err = 0;
+      ssize_t r;
+      while ( n < size_ && (r = pread(fd_, s.buf + n, size_ - n, s.off + (off_t) n)) != 0 ) {
+        if ( r > 0 )
+          n += (std::size_t) r;
+        else if ( errno != EINTR ) {
+          err = errno;
+          break;
+        }
+      }
+      lock.lock();
+      s.n = n;
+      s.err = err;
+      s.done = true;
+      done_.notify_all();
+    }
+  }
+
+  /* Starts reading the next buffer of the file into slot i. */
+  void start(std::size_t i)
+  {
+    slot &s = slots_[i];
+    s.off = next_;
+    s.n = 0;
+    s.err = 0;
+    next_ += (off_t) size_;
+#ifdef LISPREAD_IO_URING
+    if ( uring_ ) {
+      s.done = false;
+      return submit(i);
+    }
+#endif
+    std::lock_guard<std::mutex> lock(m_);
+    s.done = false;
+    queue_.push_back(i);
+    work_.notify_one();
+  }
+
+  void wait(std::size_t i)
+  {
+    slot &s = slots_[i];
+#ifdef LISPREAD_IO_URING
+    if ( uring_ ) {
+      while ( ! s.done )
+        ring_.reap([this](std::uint64_t j, int res) { complete((std::size_t) j, res); });
+      return;
+    }
+#endif
+    std::unique_lock<std::mutex> lock(m_);
+    done_.wait(lock, [&s] { return s.done; });
+  }
+
+  void stop()
+  {
+#ifdef LISPREAD_IO_URING
+    /* The kernel may still be writing into the buffers. */
+    if ( uring_ ) {
+      try {
+        for ( std::size_t i = 0; i < depth_; ++ i )
+          while ( ! slots_[i].done )
+            ring_.reap([this](std::uint64_t j, int) { slots_[(std::size_t) j].done = true; });
+      } catch ( const error & ) {
+        mem_.release();
+      }
+      return;
+    }
+#endif
+    {
+      std::lock_guard<std::mutex> lock(m_);
+      stop_ = true;
+    }
+    work_.notify_all();
+    for ( std::thread &t : threads_ )
+      t.join();
+  }
+
+public:
+  explicit readahead_input(int fd, std::size_t depth = 4, std::size_t size = 1024 * 1024, bool use_uring = true) :
+    fd_(fd), depth_(depth ? depth : 1), size_(size ? size : 1), stride_((size_ + 4095) / 4096 * 4096),
+    mem_((char*) std::aligned_alloc(4096, depth_ * stride_), &std::free), slots_(depth_)
+  {
+    if ( ! mem_ )
+      throw std::bad_alloc();
+    if ( (next_ = lseek(fd, 0, SEEK_CUR)) < 0 )
+      throw error(std::string("lseek: ") + std::strerror(errno));
+    for ( std::size_t i = 0; i < depth_; ++ i )
+      slots_[i].buf = mem_.get() + i * stride_;
+#ifdef LISPREAD_IO_URING
+    uring_ = use_uring && ring_.open((unsigned) depth_);
+#else
+    (void) use_uring;
+#endif
+    try {
+#ifdef LISPREAD_IO_URING
+      if ( ! uring_ )
+#endif
+        for ( std::size_t i = 0; i < depth_; ++ i )
+          threads_.emplace_back([this] { work(); });
+      for ( std::size_t i = 0; i < depth_; ++ i )
+        start(i);
+    } catch ( ... ) {
+      stop();
+      throw;
+    }
+  }
+  readahead_input(const readahead_input &) = delete;
+  readahead_input &operator=(const readahead_input &) = delete;
+  ~readahead_input() { stop(); }
+
+  /* "io_uring" or "pread". */
+  const char *backend() const
+  {
+#ifdef LISPREAD_IO_URING
+    if ( uring_ )
+      return "io_uring";
+#endif
+    return "pread";
+  }
+
+  std::string_view peek_window()
+  {
+    while ( 1 ) {
+      slot &s = slots_[cur_];
+      wait(cur_);
+      if ( s.err )
+        throw error(std::string("read: ") + std::strerror(s.err));
+      if ( pos_ < s.n || s.n < size_ )
+        return std::string_view(s.buf + pos_, s.n - pos_);
+      start(cur_);
+      cur_ = (cur_ + 1) % depth_;
+      pos_ = 0;
+    }
+  }
+  void advance(std::size_t n) { pos_ += n; }
+};
+
+#endif
+
+#ifdef LISPREAD_EPOLL
+
+/* A minimal epoll loop that calls a function once when an fd is readable. */
+class event_loop {
+  int ep_;
+  std::map<int, std::function<void()>> waiting_;
+public:
+  event_loop() : ep_(epoll_create1(EPOLL_CLOEXEC))
+  {
+    if ( ep_ < 0 )
+      throw error(std::string("epoll_create1: ") + std::strerror(errno));
+  }
+  event_loop(const event_loop &) = delete;
+  event_loop &operator=(const event_loop &) = delete;
+  ~event_loop() { ::close(ep_); }
+
+  void on_readable(int fd, std::function<void()> f)
+  {
+    struct epoll_event ev = { };
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if ( epoll_ctl(ep_, EPOLL_CTL_ADD, fd, &ev) < 0 )
+      throw error(std::string("epoll_ctl: ") + std::strerror(errno));
+    waiting_[fd] = std::move(f);
+  }
+
+  /* Forgets fd without calling its function, if it is waiting. */
+  void cancel(int fd)
+  {
+    if ( waiting_.erase(fd) )
+      epoll_ctl(ep_, EPOLL_CTL_DEL, fd, 0);
+  }
+
+  /* Waits up to timeout ms (-1 for ever) and calls the functions of the
+     readable fds.  Returns false if nothing is waiting. */
+  bool run_once(int timeout = -1)
+  {
+    struct epoll_event ev[16];
+    int i, n;
+    if ( waiting_.empty() )
+      return false;
+    while ( (n = epoll_wait(ep_, ev, 16, timeout)) < 0 && errno == EINTR )
+      ;
+    if ( n < 0 )
+      throw error(std::string("epoll_wait: ") + std::strerror(errno));
+    for ( i = 0; i < n; ++ i ) {
+      auto w = waiting_.find(ev[i].data.fd);
+      if ( w == waiting_.end() )
+        continue;       /* Cancelled by an earlier function. */
+      std::function<void()> f = std::move(w->second);
+      waiting_.erase(w);
+      epoll_ctl(ep_, EPOLL_CTL_DEL, ev[i].data.fd, 0);
+      f();
+    }
+    return true;
+  }
+
+  /* Runs until nothing is waiting. */
+  void run()
+  {
+    while ( run_once() )
+      ;
+  }
+};
+
+#endif
+
+/* Scanning kernels for the reader's windows, chosen at run time.
+   Each returns the index of the first byte of p[0, n) that stops the
+   scan, or n. */
+namespace simd {
+
+struct kernels {
+  const char *name;
+  bool (*supported)();
+  std::size_t (*skip_space)(const char *p, std::size_t n);     /* Stops at non-whitespace. */
+  std::size_t (*find_quote)(const char *p, std::size_t n);     /* Stops at '"' or '\\'. */
+  std::size_t (*find_either)(const char *p, std::size_t n, char a, char b); /* Stops at a or b. */
+  std::size_t (*find_terminator)(const char *p, std::size_t n, bool brackets); /* Stops at a macro terminating char. */
+};
+
+/* Whitespace is the C locale's, as isspace(). */
+inline bool spaceQ(unsigned char c) { return c == ' ' || (unsigned char) (c - '\t') < 5; }
+
+inline bool terminatorQ(unsigned char c, bool brackets)
+{
+  return c == ';' || c == '(' || c == ')' || c == '#' || spaceQ(c)
+    || (brackets && (c == '[' || c == ']'));
+}
+
+inline bool scalar_supported() { return true; }
+
+inline std::size_t skip_space_scalar(const char *p, std::size_t n)
+{
+  std::size_t i = 0;
+  while ( i < n && spaceQ(p[i]) )
+    ++ i;
+  return i;
+}
+
+inline std::size_t find_either_scalar(const char *p, std::size_t n, char a, char b)
+{
+  std::size_t i = 0;
+  while ( i < n && p[i] != a && p[i] != b )
+    ++ i;
+  return i;
+}
+
+inline std::size_t find_quote_scalar(const char *p, std::size_t n) { return find_either_scalar(p, n, '"', '\\'); }
+
+inline std::size_t find_terminator_scalar(const char *p, std::size_t n, bool brackets)
+{
+  std::size_t i = 0;
+  while ( i < n && ! terminatorQ(p[i], brackets) )
+    ++ i;
+  return i;
+}
+
+#ifdef LISPREAD_X86
+
+/* SSE4.2: PCMPESTRI against the set of stop bytes, 16 bytes at a time. */
+
+__attribute__((target("sse4.2")))
+inline std::size_t skip_space_sse42(const char *p, std::size_t n)
+{
+  const __m128i set = _mm_setr_epi8(' ', '\t', '\n', '\v', '\f', '\r', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  std::size_t i;
+  for ( i = 0; i + 16 <= n; i += 16 ) {
+    int k = _mm_cmpestri(set, 6, _mm_loadu_si128((const __m128i*) (p + i)), 16,
+                         _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_NEGATIVE_POLARITY);
+    if ( k < 16 )
+      return i + k;
+  }
+  return i + skip_space_scalar(p + i, n - i);
+}
+
+__attribute__((target("sse4.2")))
+inline std::size_t find_either_sse42(const char *p, std::size_t n, char a, char b)
+{
+  const __m128i set = _mm_setr_epi8(a, b, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  std::size_t i;
+  for ( i = 0; i + 16 <= n; i += 16 ) {
+    int k = _mm_cmpestri(set, 2, _mm_loadu_si128((const __m128i*) (p + i)), 16,
+                         _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+    if ( k < 16 )
+      return i + k;
+  }
+  return i + find_either_scalar(p + i, n - i, a, b);
+}
+
+__attribute__((target("sse4.2")))
+inline std::size_t find_quote_sse42(const char *p, std::size_t n) { return find_either_sse42(p, n, '"', '\\'); }
+
+__attribute__((target("sse4.2")))
+inline std::size_t find_terminator_sse42(const char *p, std::size_t n, bool brackets)
+{
+  const __m128i set = _mm_setr_epi8(' ', '\t', '\n', '\v', '\f', '\r', ';', '(', ')', '#', '[', ']', 0, 0, 0, 0);
+  int set_n = brackets ? 12 : 10;
+  std::size_t i;
+  for ( i = 0; i + 16 <= n; i += 16 ) {
+    int k = _mm_cmpestri(set, set_n, _mm_loadu_si128((const __m128i*) (p + i)), 16,
+                         _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+    if ( k < 16 )
+      return i + k;
+  }
+  return i + find_terminator_scalar(p + i, n - i, brackets);
+}
+
+/* AVX2: byte compares on 32 bytes at a time, to a bit mask. */
+
+__attribute__((target("avx2")))
+inline __m256i space_avx2(__m256i x)
+{
+  __m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8('\t'));
+  return _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')),
+                         _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(4)), d));
+}
+
+__attribute__((target("avx2")))
+inline std::size_t skip_space_avx2(const char *p, std::size_t n)
+{
+  std::size_t i;
+  for ( i = 0; i + 32 <= n; i += 32 ) {
+    unsigned m = ~ (unsigned) _mm256_movemask_epi8(space_avx2(_mm256_loadu_si256((const __m256i*) (p + i))));
+    if ( m )
+      return i + __builtin_ctz(m);
+  }
+  return i + skip_space_scalar(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline std::size_t find_either_avx2(const char *p, std::size_t n, char a, char b)
+{
+  const __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b);
+  std::size_t i;
+  for ( i = 0; i + 32 <= n; i += 32 ) {
+    __m256i x = _mm256_loadu_si256((const __m256i*) (p + i));
+    unsigned m = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(x, va), _mm256_cmpeq_epi8(x, vb)));
+    if ( m )
+      return i + __builtin_ctz(m);
+  }
+  return i + find_either_scalar(p + i, n - i, a, b);
+}
+
+__attribute__((target("avx2")))
+inline std::size_t find_quote_avx2(const char *p, std::size_t n) { return find_either_avx2(p, n, '"', '\\'); }
+
+__attribute__((target("avx2")))
+inline std::size_t find_terminator_avx2(const char *p, std::size_t n, bool brackets)
+{
+  std::size_t i;
+  for ( i = 0; i + 32 <= n; i += 32 ) {
+    __m256i x = _mm256_loadu_si256((const __m256i*) (p + i));
+    __m256i t = _mm256_or_si256(space_avx2(x),
+                  _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(';')),
+                                                  _mm256_cmpeq_epi8(x, _mm256_set1_epi8('#'))),
+                                  _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('(')),
+                                                  _mm256_cmpeq_epi8(x, _mm256_set1_epi8(')')))));
+    if ( brackets )
+      t = _mm256_or_si256(t, _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('[')),
+                                             _mm256_cmpeq_epi8(x, _mm256_set1_epi8(']'))));
+    unsigned m = _mm256_movemask_epi8(t);
+    if ( m )
+      return i + __builtin_ctz(m);
+  }
+  return i + find_terminator_scalar(p + i, n - i, brackets);
+}
+
+/* AVX-512BW: compares straight to 64-bit masks, 64 bytes at a time. */
+
+__attribute__((target("avx512bw")))
+inline __mmask64 space_avx512(__m512i x)
+{
+  return _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8(' '))
+    | _mm512_cmple_epu8_mask(_mm512_sub_epi8(x, _mm512_set1_epi8('\t')), _mm512_set1_epi8(4));
+}
+
+__attribute__((target("avx512bw")))
+inline std::size_t skip_space_avx512(const char *p, std::size_t n)
+{
+  std::size_t i;
+  for ( i = 0; i + 64 <= n; i += 64 ) {
+    __mmask64 m = ~ space_avx512(_mm512_loadu_si512(p + i));
+    if ( m )
+      return i + __builtin_ctzll(m);
+  }
+  return i + skip_space_scalar(p + i, n - i);
+}
+
+__attribute__((target("avx512bw")))
+inline std::size_t find_either_avx512(const char *p, std::size_t n, char a, char b)
+{
+  const __m512i va = _mm512_set1_epi8(a), vb = _mm512_set1_epi8(b);
+  std::size_t i;
+  for ( i = 0; i + 64 <= n; i += 64 ) {
+    __m512i x = _mm512_loadu_si512(p + i);
+    __mmask64 m = _mm512_cmpeq_epi8_mask(x, va) | _mm512_cmpeq_epi8_mask(x, vb);
+    if ( m )
+      return i + __builtin_ctzll(m);
+  }
+  return i + find_either_scalar(p + i, n - i, a, b);
+}
+
+__attribute__((target("avx512bw")))
+inline std::size_t find_quote_avx512(const char *p, std::size_t n) { return find_either_avx512(p, n, '"', '\\'); }
+
+__attribute__((target("avx512bw")))
+inline std::size_t find_terminator_avx512(const char *p, std::size_t n, bool brackets)
+{
+  std::size_t i;
+  for ( i = 0; i + 64 <= n; i += 64 ) {
+    __m512i x = _mm512_loadu_si512(p + i);
+    __mmask64 m = space_avx512(x)
+      | _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8(';')) | _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8('#'))
+      | _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8('(')) | _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8(')'));
+    if ( brackets )
+      m |= _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8('[')) | _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8(']'));
+    if ( m )
+      return i + __builtin_ctzll(m);
+  }
+  return i + find_terminator_scalar(p + i, n - i, brackets);
+}
+
+inline bool sse42_supported() { __builtin_cpu_init(); return __builtin_cpu_supports("sse4.2"); }
+inline bool avx2_supported() { __builtin_cpu_init(); return __builtin_cpu_supports("avx2"); }
+inline bool avx512_supported() { __builtin_cpu_init(); return __builtin_cpu_supports("avx512bw"); }
+
+#endif
+
+/* From the least to the most capable. */
+inline const kernels table[] = {
+  { "scalar", scalar_supported, skip_space_scalar, find_quote_scalar, find_either_scalar, find_terminator_scalar },
+#ifdef LISPREAD_X86
+  { "sse42", sse42_supported, skip_space_sse42, find_quote_sse42, find_either_sse42, find_terminator_sse42 },
+  { "avx2", avx2_supported, skip_space_avx2, find_quote_avx2, find_either_avx2, find_terminator_avx2 },
+  { "avx512", avx512_supported, skip_space_avx512, find_quote_avx512, find_either_avx512, find_terminator_avx512 },
+#endif
+};
+
+/* Returns the kernels named name, or nullptr if this CPU cannot run them. */
+inline const kernels *kernels_for(std::string_view name)
+{
+  for ( const kernels &k : table ) {
+    if ( name == k.name )
+      return k.supported() ? &k : nullptr;
+  }
+  return nullptr;
+}
+
+/* Returns the most capable kernels that this CPU runs, up to name, or
+   up to the end of the table if name is not one of them. */
+inline const kernels &pick(std::string_view name = std::string_view())
+{
+  const kernels *best = &table[0];
+  for ( const kernels &k : table ) {
+    if ( k.supported() )
+      best = &k;
+    if ( name == k.name )
+      break;
+  }
+  return *best;
+}
+
+inline std::atomic<const kernels*> active_{nullptr};
+
+/* The kernels new readers use: on first use, pick(getenv("LISPREAD_SIMD")). */
+inline const kernels &active()
+{
+  const kernels *k = active_.load(std::memory_order_acquire);
+  if ( ! k ) {
+    const char *env = std::getenv("LISPREAD_SIMD");
+    k = &pick(env ? env : "");
+    active_.store(k, std::memory_order_release);
+  }
+  return *k;
+}
+
+/* Makes the kernels named name active; returns false if it cannot. */
+inline bool use(std::string_view name)
+{
+  const kernels *k = kernels_for(name);
+  if ( k )
+    active_.store(k, std::memory_order_release);
+  return k != nullptr;
+}
+
+} // namespace simd
+
+namespace detail {
+
+#define LISPREAD_FEATURE(NAME) \
+  template <class T, class = void> struct NAME : std::false_type { }; \
+  template <class T> struct NAME<T, std::void_t<decltype(T::NAME)>> : std::bool_constant<T::NAME> { };
+LISPREAD_FEATURE(bracket_lists)
+LISPREAD_FEATURE(unspecified)
+LISPREAD_FEATURE(logical_eof)
+LISPREAD_FEATURE(macro_chars)
+#undef LISPREAD_FEATURE
+
+template <class T, class = void> struct has_make_list : std::false_type { };
+template <class T> struct has_make_list<T, std::void_t<decltype(T::make_list(std::declval<const typename T::value*>(), std::size_t(), std::declval<typename T::value>()))>> : std::true_type { };
+
+inline bool equal_nocase(std::string_view a, const char *b)
+{
+  std::size_t i;
+  for ( i = 0; i < a.size() && b[i]; ++ i ) {
+    if ( std::tolower((unsigned char) a[i]) != std::tolower((unsigned char) b[i]) )
+      return false;
+  }
+  return i == a.size() && ! b[i];
+}
+
+/* The R7RS character names, at the perfect hash that lispread.c's
+   read_char_name() uses: ((s[0] | 0x20) + ((s[1] | 0x20) << 1) + size) % 16. */
+struct char_name { const char *name; char c; };
+inline constexpr char_name char_names[16] = {
+  { }, { "escape", 0x1b }, { "return", '\r' }, { }, { "delete", 0x7f }, { }, { }, { },
+  { "space", ' ' }, { "tab", '\t' }, { }, { }, { "null", '\0' }, { "backspace", '\b' }, { "alarm", '\a' }, { "newline", '\n' },
+};
+
+/* Returns the character named by s, of 2 or more letters, or -1. */
+inline int char_name_lookup(std::string_view s)
+{
+  const char_name &n = char_names[((s[0] | 0x20) + ((s[1] | 0x20) << 1) + s.size()) % 16];
+  return n.name && equal_nocase(s, n.name) ? (unsigned char) n.c : -1;
+}
+
+/* Returns the code point of the hex digits in s, or -1. */
+constexpr long char_hex(std::string_view s)
+{
+  unsigned long c = 0;
+  if ( s.empty() || s.size() > 8 )
+    return -1;
+  for ( char d : s ) {
+    int v = d >= '0' && d <= '9' ? d - '0' : (d | 0x20) >= 'a' && (d | 0x20) <= 'f' ? (d | 0x20) - 'a' + 10 : -1;
+    if ( v < 0 )
+      return -1;
+    c = c * 16 + v;
+  }
+  if ( c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff) )
+    return -1;
+  return c;
+}
+
+/* Finds where a datum may end in bytes given a piece at a time, without
+   reading it: it follows strings, comments, character names and list
+   depth as the reader does, and keeps its state between pieces.  end is
+   the offset just after the last top-level datum, or the byte that a read
+   stops at with an error. */
+class datum_scan {
+  enum { TOP, TOKEN, STRING, STRING_ESCAPE, COMMA, HASH, CHAR, CHAR_X, CHAR_NAME,
+         LINE_COMMENT, BLOCK, BLOCK_BAR, BLOCK_HASH } state_ = TOP;
+  bool brackets_, unspecified_, logical_eof_, macro_chars_, hex_ = false;
+  std::size_t depth_ = 0, level_ = 0;
+
+  static bool token_charQ(unsigned char c)
+  {
+    return std::isalnum(c) || (c != 0 && std::strchr("~!@$%&*_+-=:<>^.?/|", c)) || c >= 128;
+  }
+
+  void ends(std::size_t i)
+  {
+    if ( depth_ == 0 )
+      end = i;
+  }
+
+  /* A read that fails at byte i leaves the next one at the top level. */
+  void fails(std::size_t i)
+  {
+    depth_ = 0;
+    end = i;
+  }
+
+  void closes(std::size_t i)
+  {
+    if ( depth_ == 0 )
+      return fails(i + 1);
+    -- depth_;
+    ends(i + 1);
+  }
+
+  void top(unsigned char c, std::size_t i)
+  {
+    state_ = TOP;
+    if ( simd::spaceQ(c) )
+      return;
+    switch ( c ) {
+    case '(': ++ depth_; return;
+    case ')': closes(i); return;
+    case '"': state_ = STRING; return;
+    case '#': state_ = HASH; return;
+    case ';': state_ = LINE_COMMENT; return;
+    case ',': state_ = COMMA; return;
+    case '\'': case '`': return;
+    case '[': if ( brackets_ ) { ++ depth_; return; } break;
+    case ']': if ( brackets_ ) { closes(i); return; } break;
+    }
+    if ( token_charQ(c) )
+      state_ = TOKEN;
+    else
+      fails(i + 1);
+  }
+
+  void hash(unsigned char c, std::size_t i)
+  {
+    switch ( c ) {
+    case '!': state_ = LINE_COMMENT; return;
+    case '|': state_ = BLOCK; level_ = 1; return;
+    case ';': state_ = TOP; return;
+    case '(': state_ = TOP; ++ depth_; return;
+    case '\\': state_ = CHAR; return;
+    case 'e': case 'E': case 'i': case 'I': return;
+    case 'b': case 'B': case 'o': case 'O': case 'd': case 'D': case 'x': case 'X': state_ = TOKEN; return;
+    case 't': case 'T': case 'f': case 'F': state_ = TOP; ends(i + 1); return;
+    case 'u': case 'U': if ( unspecified_ ) { state_ = TOP; ends(i + 1); return; } break;
+    case '#': if ( logical_eof_ ) { state_ = TOP; ends(i + 1); return; } break;
+    }
+    if ( macro_chars_ ) {
+      state_ = TOP;
+      ends(i + 1);
+    } else {
+      /* "bad sequence": C is read again at the top level. */
+      fails(i);
+      top(c, i);
+    }
+  }
+
+  void char_name(unsigned char c, std::size_t i)
+  {
+    if ( (hex_ ? std::isalnum(c) : std::isalpha(c)) && ! simd::terminatorQ(c, brackets_) )
+      return;
+    ends(i);
+    top(c, i);
+  }
+
+public:
+  std::size_t end = 0;
+
+  datum_scan(bool brackets, bool unspecified, bool logical_eof, bool macro_chars) :
+    brackets_(brackets), unspecified_(unspecified), logical_eof_(logical_eof), macro_chars_(macro_chars) { }
+
+  /* Starts again at the top level, as the reader does after an error. */
+  void reset()
+  {
+    state_ = TOP;
+    depth_ = level_ = 0;
+    end = 0;
+  }
+
+  /* Scans the bytes at p, which are at offset i onwards. */
+  void scan(const char *p, std::size_t n, std::size_t i)
+  {
+    for ( std::size_t e = i + n; i < e; ++ i ) {
+      unsigned char c = *p ++;
+      switch ( state_ ) {
+      case TOP: top(c, i); break;
+      case TOKEN: if ( simd::terminatorQ(c, brackets_) ) { ends(i); top(c, i); } break;
+      case STRING: if ( c == '\\' ) state_ = STRING_ESCAPE; else if ( c == '"' ) { state_ = TOP; ends(i + 1); } break;
+      case STRING_ESCAPE: state_ = STRING; break;
+      case COMMA: if ( c == '@' ) state_ = TOP; else top(c, i); break;
+      case HASH: hash(c, i); break;
+      case CHAR:
+        if ( c == 'x' || c == 'X' )
+          state_ = CHAR_X;
+        else if ( std::isalpha(c) )
+          state_ = CHAR_NAME, hex_ = false;
+        else
+          state_ = TOP, ends(i + 1);
+        break;
+      case CHAR_X: hex_ = std::isxdigit(c); state_ = CHAR_NAME; char_name(c, i); break;
+      case CHAR_NAME: char_name(c, i); break;
+      case LINE_COMMENT: if ( c == '\n' ) state_ = TOP; break;
+      case BLOCK: state_ = c == '|' ? BLOCK_BAR : c == '#' ? BLOCK_HASH : BLOCK; break;
+      case BLOCK_BAR:
+        if ( c == '#' )
+          state_ = -- level_ ? BLOCK : TOP;
+        else
+          state_ = c == '|' ? BLOCK_BAR : BLOCK;
+        break;
+      case BLOCK_HASH:
+        if ( c == '|' )
+          ++ level_, state_ = BLOCK;
+        else
+          state_ = c == '#' ? BLOCK_HASH : BLOCK;
+        break;
+      }
+    }
+  }
+};
+
+} // namespace detail
+
+template <class Traits, class Input>
+class reader {
+public:
+  using value = typename Traits::value;
+
+  static constexpr bool bracket_lists = detail::bracket_lists<Traits>::value;
+  static constexpr bool unspecified = detail::unspecified<Traits>::value;
+  static constexpr bool logical_eof = detail::logical_eof<Traits>::value;
+  static constexpr bool macro_chars = detail::macro_chars<Traits>::value;
+
+  explicit reader(Input &in) :
+    in_(in),
+    quote_(Traits::symbol("quote")),
+    quasiquote_(Traits::symbol("quasiquote")),
+    unquote_(Traits::symbol("unquote")),
+    unquote_splicing_(Traits::symbol("unquote-splicing")),
+    dot_(Traits::symbol("."))
+  { }
+
+  /* Returns the next datum, or eos() at the end of the input. */
+  value read()
+  {
+    struct sync {
+      reader &r;
+      ~sync() { r.in_.advance(r.pos_); r.w_ = std::string_view(); r.pos_ = 0; }
+    } s{*this};
+    items_.clear();
+    return read_datum();
+  }
+
+private:
+  Input &in_;
+  std::string_view w_;          /* The input window; w_[pos_] is the next byte. */
+  std::size_t pos_ = 0;
+  const simd::kernels &simd_ = simd::active();
+  value quote_, quasiquote_, unquote_, unquote_splicing_, dot_;
+  std::string token_;
+  std::vector<value> items_;    /* The elements of the lists being read. */
+
+  /* Consumes the window and gets the next one.  Returns false at the end. */
+  bool refill()
+  {
+    in_.advance(pos_);
+    pos_ = 0;
+    w_ = std::string_view();
+    w_ = in_.peek_window();
+    return ! w_.empty();
+  }
+
+  int peek()
+  {
+    if ( pos_ == w_.size() && ! refill() )
+      return EOF;
+    return (unsigned char) w_[pos_];
+  }
+
+  int get()
+  {
+    if ( pos_ == w_.size() && ! refill() )
+      return EOF;
+    return (unsigned char) w_[pos_ ++];
+  }
+
+  /* Puts back the byte just returned by get(), which is still in the window. */
+  void unget() { -- pos_; }
+
+  /* Skips to the next '\n' without consuming it. */
+  void skip_line()
+  {
+    do {
+      const void *nl = std::memchr(w_.data() + pos_, '\n', w_.size() - pos_);
+      if ( nl ) {
+        pos_ = (const char*) nl - w_.data();
+        return;
+      }
+      pos_ = w_.size();
+    } while ( refill() );
+  }
+
+  /* Skips the rest of a #| comment |#, which may nest: only the '|' and
+     '#' bytes are looked at. */
+  void skip_block_comment()
+  {
+    int level = 1, c;
+    while ( level > 0 ) {
+      pos_ += simd_.find_either(w_.data() + pos_, w_.size() - pos_, '|', '#');
+      if ( (c = get()) == EOF )
+        fail("eos inside #| comment |#");
+      if ( c == '|' && peek() == '#' ) {
+        get();
+        -- level;
+      } else if ( c == '#' && peek() == '|' ) {
+        get();
+        ++ level;
+      }
+    }
+  }
+
+  [[noreturn]] static void fail(const char *format, ...)
+  {
+    char buf[256];
+    va_list vap;
+    va_start(vap, format);
+    std::vsnprintf(buf, sizeof(buf), format, vap);
+    va_end(vap);
+    throw error(buf);
+  }
+
+  static bool macro_terminating_charQ(int c)
+  {
+    return c == EOF || simd::terminatorQ(c, bracket_lists);
+  }
+
+  static bool token_charQ(int c)
+  {
+    return std::isalnum(c) || (c != 0 && std::strchr("~!@$%&*_+-=:<>^.?/|", c)) || c >= 128;
+  }
+
+  int eat_whitespace_peekchar()
+  {
+    while ( 1 ) {
+      pos_ += simd_.skip_space(w_.data() + pos_, w_.size() - pos_);
+      if ( pos_ == w_.size() ) {
+        if ( ! refill() )
+          return EOF;
+        continue;
+      }
+      int c = (unsigned char) w_[pos_];
+      if ( c != ';' )
+        return c;
+      skip_line();
+    }
+  }
+
+  value make_list(const value *p, std::size_t n, value tail)
+  {
+    if constexpr ( detail::has_make_list<Traits>::value ) {
+      if ( n > 0 )
+        return Traits::make_list(p, n, tail);
+      return tail;
+    } else {
+      while ( n > 0 )
+        tail = Traits::cons(p[-- n], tail);
+      return tail;
+    }
+  }
+
+  value read_datum()
+  {
+    while ( 1 ) {
+      int c = eat_whitespace_peekchar();
+      if ( c == EOF )
+        return Traits::eos();
+      get();
+      switch ( c ) {
+      case '\'':
+        return quote(quote_);
+      case '`':
+        return quote(quasiquote_);
+      case ',':
+        if ( peek() == '@' ) {
+          get();
+          return quote(unquote_splicing_);
+        }
+        return quote(unquote_);
+      case '(':
+        return read_list(')');
+      case '[':
+        if constexpr ( bracket_lists )
+          return read_list(']');
+        break;
+      case '#': {
+        value x;
+        if ( read_hash(x) )
+          return x;
+        continue;
+      }
+      case '"':
+        return read_string();
+      default:
+        if ( token_charQ(c) ) {
+          unget();
+          return read_token(10, false);
+        }
+        break;
+      }
+      fail("unexpected character '%c'", c);
+    }
+  }
+
+  value quote(value sym)
+  {
+    value x = read_datum();
+    return Traits::cons(sym, Traits::cons(x, Traits::nil()));
+  }
+
+  value read_list(int terminator)
+  {
+    std::size_t base = items_.size();
+    value tail = Traits::nil();
+
+    while ( 1 ) {
+      int c = eat_whitespace_peekchar();
+      if ( c == EOF )
+        fail("eos in list");
+      if ( c == terminator ) {
+        get();
+        break;
+      }
+      value x = read_datum();
+      if ( Traits::eq(x, dot_) ) {
+        if ( items_.size() == base )
+          fail("expected something before '.' in list");
+        tail = read_datum();
+        c = eat_whitespace_peekchar();
+        if ( c == EOF )
+          fail("eos in '.' list after cdr");
+        get();
+        if ( c != terminator )
+          fail("expected '%c': found '%c'", terminator, c);
+        break;
+      }
+      items_.push_back(x);
+    }
+    value l = make_list(items_.data() + base, items_.size() - base, tail);
+    items_.resize(base);
+    return l;
+  }
+
+  /* Reads after '#'.  Returns false for a comment. */
+  bool read_hash(value &x)
+  {
+    int c;
+  hash_again:
+    c = peek();
+    switch ( c ) {
+    case EOF:
+      fail("eos after '#'");
+
+      /* #! sh-bang comment till EOL. */
+    case '!':
+      skip_line();
+      return false;
+
+      /* #| nesting comment. |# */
+    case '|':
+      get();
+      skip_block_comment();
+      return false;
+
+      /* s-expr comment ala chez scheme */
+    case ';':
+      get();
+      read_datum();
+      return false;
+
+    case '(':
+      x = Traits::list_2_vector(read_datum());
+      return true;
+
+    case '\\':
+      x = read_char();
+      return true;
+
+    case 'f': case 'F':
+      get();
+      x = Traits::f();
+      return true;
+
+    case 't': case 'T':
+      get();
+      x = Traits::t();
+      return true;
+
+    case 'u': case 'U':
+      if constexpr ( unspecified ) {
+        get();
+        x = Traits::u();
+        return true;
+      }
+      break;
+
+    case '#':
+      if constexpr ( logical_eof ) {
+        get();
+        x = Traits::e();
+        return true;
+      }
+      break;
+
+    case 'e': case 'E':
+    case 'i': case 'I':
+      get();
+      goto hash_again;
+
+    case 'b': case 'B': get(); x = read_token(2, true); return true;
+    case 'o': case 'O': get(); x = read_token(8, true); return true;
+    case 'd': case 'D': get(); x = read_token(10, true); return true;
+    case 'x': case 'X': get(); x = read_token(16, true); return true;
+    }
+    if constexpr ( macro_chars ) {
+      get();
+      return Traits::call_macro_char(c, x);
+    }
+    fail("bad sequence: #%c", c);
+  }
+
+  value read_char()
+  {
+    int c;
+    get();
+    if ( (c = get()) == EOF )
+      fail("eos after '#\\'");
+    token_.assign(1, (char) c);
+    bool hex = (c == 'x' || c == 'X') && std::isxdigit(peek());
+    if ( std::isalpha(c) ) {
+      while ( (hex ? std::isalnum(c = peek()) : std::isalpha(c = peek())) && ! macro_terminating_charQ(c) ) {
+        get();
+        token_ += (char) c;
+      }
+    }
+    long cp;
+    if ( token_.size() == 1 )
+      cp = (unsigned char) token_[0];
+    else if ( hex ) {
+      if ( (cp = detail::char_hex(std::string_view(token_).substr(1))) < 0 )
+        fail("bad char '#\\%s'", token_.c_str());
+    } else if ( (cp = detail::char_name_lookup(token_)) < 0 )
+      fail("unknown char name '#\\%s'", token_.c_str());
+    return Traits::make_char(cp);
+  }
+
+  /* A string without escapes inside one window is passed as a view of it. */
+  value read_string()
+  {
+    int c;
+    std::size_t start = pos_;
+    pos_ += simd_.find_quote(w_.data() + pos_, w_.size() - pos_);
+    if ( pos_ < w_.size() && w_[pos_] == '"' )
+      return Traits::string(w_.substr(start, pos_ ++ - start));
+    token_.assign(w_.data() + start, pos_ - start);
+    while ( (c = get()) != '"' ) {
+      if ( c == '\\' ) {
+        switch ( c = get() ) {
+        case 'n': c = '\n'; break;
+        case 't': c = '\t'; break;
+        case 'r': c = '\r'; break;
+        case 'a': c = '\a'; break;
+        case 'b': c = '\b'; break;
+        case '0': c = '\0'; break;
+        }
+      }
+      if ( c == EOF )
+        fail("EOS in string");
+      token_ += (char) c;
+      start = pos_;
+      pos_ += simd_.find_quote(w_.data() + pos_, w_.size() - pos_);
+      token_.append(w_.data() + start, pos_ - start);
+    }
+    return Traits::string(std::string_view(token_));
+  }
+
+  /* Returns the bytes up to the next macro terminating char: a view of
+     the window, or of token_ if they cross into the next window. */
+  std::string_view scan_token()
+  {
+    std::size_t start = pos_;
+    token_.clear();
+    while ( 1 ) {
+      pos_ += simd_.find_terminator(w_.data() + pos_, w_.size() - pos_, bracket_lists);
+      if ( pos_ < w_.size() && token_.empty() )
+        return w_.substr(start, pos_ - start);
+      token_.append(w_.data() + start, pos_ - start);
+      if ( pos_ < w_.size() || ! refill() )
+        return token_;
+      start = 0;
+    }
+  }
+
+  /* Reads a number or symbol, or a number after #b, #o, #d or #x. */
+  value read_token(int radix, bool prefixed)
+  {
+    std::string_view s = scan_token();
+    value n = Traits::string_2_number(s, radix);
+    if ( Traits::eq(n, Traits::f()) ) {
+      if ( prefixed )
+        fail("invalid number string '%.*s'", (int) s.size(), s.data());
+      n = Traits::string_2_symbol(s);
+    }
+    return n;
+  }
+};
+
+#if __cplusplus >= 202002L
+
+/* An input range of the datums of an input, read as it is iterated by one
+   reader, whose buffers are reused from datum to datum.  Read errors are
+   thrown from begin() and ++. */
+template <class Traits, class Input>
+class datum_range : public std::ranges::view_interface<datum_range<Traits, Input>> {
+  struct state {
+    reader<Traits, Input> r;
+    typename Traits::value x;
+    explicit state(Input &in) : r(in) { }
+  };
+  std::unique_ptr<state> s_;
+public:
+  class iterator {
+    state *s_ = 0;
+  public:
+    using iterator_concept = std::input_iterator_tag;
+    using value_type = typename Traits::value;
+    using difference_type = std::ptrdiff_t;
+    iterator() = default;
+    explicit iterator(state *s) : s_(s) { }
+    const value_type &operator*() const { return s_->x; }
+    iterator &operator++() { s_->x = s_->r.read(); return *this; }
+    void operator++(int) { ++ *this; }
+    friend bool operator==(const iterator &i, std::default_sentinel_t)
+    {
+      return Traits::eq(i.s_->x, Traits::eos());
+    }
+  };
+
+  explicit datum_range(Input &in) : s_(new state(in)) { }
+  iterator begin() { s_->x = s_->r.read(); return iterator(s_.get()); }
+  std::default_sentinel_t end() const { return std::default_sentinel; }
+};
+
+/* for ( auto x : lispread::datums(in, my_traits()) ) ... */
+template <class Traits, class Input>
+datum_range<Traits, Input> datums(Input &in, Traits = Traits())
+{
+  return datum_range<Traits, Input>(in);
+}
+
+#endif
+
+#ifdef __cpp_impl_coroutine
+
+/* Reads datums from bytes that arrive over time, in a coroutine. */
+template <class Traits>
+class async_reader {
+public:
+  using value = typename Traits::value;
+
+  /* Bytes are given with feed() and close(). */
+  async_reader() : r_(in_) { }
+
+#ifdef LISPREAD_EPOLL
+  /* Bytes are read from the non-blocking fd whenever loop finds it readable. */
+  async_reader(event_loop &loop, int fd) : r_(in_), loop_(&loop), fd_(fd) { }
+
+  /* The loop must not call a reader that is gone. */
+  ~async_reader()
+  {
+    if ( loop_ )
+      loop_->cancel(fd_);
+  }
+#endif
+
+  async_reader(const async_reader &) = delete;
+  async_reader &operator=(const async_reader &) = delete;
+
+  /* Adds bytes to the input and resumes a waiting next() if a datum is complete. */
+  void feed(std::string_view s)
+  {
+    in_.buf.append(s);
+    wake();
+  }
+
+  /* Ends the input. */
+  void close()
+  {
+    in_.closed = true;
+    wake();
+  }
+
+  class next_awaiter {
+    async_reader &a_;
+  public:
+    explicit next_awaiter(async_reader &a) : a_(a) { }
+    bool await_ready() { return a_.poll(); }
+    void await_suspend(std::coroutine_handle<> h)
+    {
+      a_.waiter_ = h;
+#ifdef LISPREAD_EPOLL
+      if ( a_.loop_ )
+        a_.wait_readable();
+#endif
+    }
+    value await_resume() { return a_.result(); }
+  };
+
+  /* co_await next() returns the next datum, or eos() after close(). */
+  next_awaiter next() { return next_awaiter(*this); }
+
+private:
+  /* The bytes fed so far from pos; runs dry until closed. */
+  struct underflow { };
+  struct chunk_input {
+    std::string buf;
+    std::size_t pos = 0, scan = 0;
+    bool closed = false;
+    std::string_view peek_window()
+    {
+      if ( scan == buf.size() && ! closed )
+        throw underflow();
+      return std::string_view(buf).substr(scan);
+    }
+    void advance(std::size_t n) { scan += n; }
+  };
+
+  chunk_input in_;
+  reader<Traits, chunk_input> r_;
+  detail::datum_scan scan_{reader<Traits, chunk_input>::bracket_lists, reader<Traits, chunk_input>::unspecified,
+                           reader<Traits, chunk_input>::logical_eof, reader<Traits, chunk_input>::macro_chars};
+  std::size_t scanned_ = 0;     /* The bytes of in_.buf given to scan_. */
+  std::coroutine_handle<> waiter_;
+  bool ready_ = false;
+  value x_;
+  std::exception_ptr error_;
+#ifdef LISPREAD_EPOLL
+  event_loop *loop_ = 0;
+  int fd_ = -1;
+#endif
+
+  /* Tries to read a datum from the bytes so far, once scan_ has found
+     where one may end. */
+  bool poll()
+  {
+    if ( ready_ )
+      return true;
+#ifdef LISPREAD_EPOLL
+    if ( loop_ )
+      fill();
+#endif
+    scan_.scan(in_.buf.data() + scanned_, in_.buf.size() - scanned_, scanned_);
+    scanned_ = in_.buf.size();
+    if ( scan_.end <= in_.pos && ! in_.closed )
+      return false;
+    in_.scan = in_.pos;
+    try {
+      x_ = r_.read();
+    } catch ( const underflow & ) {
+      return false;
+    } catch ( ... ) {
+      error_ = std::current_exception();
+    }
+    in_.pos = in_.scan;
+    if ( error_ ) {
+      scan_.reset();
+      scan_.scan(in_.buf.data() + in_.pos, in_.buf.size() - in_.pos, in_.pos);
+    }
+    if ( in_.pos > 4096 && in_.pos * 2 > in_.buf.size() ) {
+      in_.buf.erase(0, in_.pos);
+      scanned_ -= in_.pos;
+      scan_.end = scan_.end > in_.pos ? scan_.end - in_.pos : 0;
+      in_.pos = 0;
+    }
+    return ready_ = true;
+  }
+
+  value result()
+  {
+    ready_ = false;
+    if ( error_ )
+      std::rethrow_exception(std::exchange(error_, nullptr));
+    return x_;
+  }
+
+  void wake()
+  {
+    if ( waiter_ && poll() )
+      std::exchange(waiter_, nullptr).resume();
+  }
+
+#ifdef LISPREAD_EPOLL
+  /* Reads what the fd has now. */
+  void fill()
+  {
+    char buf[64 * 1024];
+    ssize_t n;
+    while ( ! in_.closed ) {
+      while ( (n = ::read(fd_, buf, sizeof(buf))) < 0 && errno == EINTR )
+        ;
+      if ( n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+        return;
+      if ( n < 0 )
+        throw error(std::string("read: ") + std::strerror(errno));
+      if ( n == 0 )
+        in_.closed = true;
+      in_.buf.append(buf, (std::size_t) n);
+    }
+  }
+
+  void wait_readable()
+  {
+    loop_->on_readable(fd_, [this] {
+      if ( ! poll() )
+        wait_readable();
+      else
+        std::exchange(waiter_, nullptr).resume();
+    });
+  }
+#endif
+};
+
+#endif
+
+#if __cplusplus >= 202002L
+
+/* Compile-time reading of string literals into constant trees. */
+namespace ct {
+
+enum class kind : unsigned char { nil, t, f, pair, vector, fixnum, character, string, symbol };
+
+/* A pair's car and cdr, or a vector's list, are cell indexes in a and b;
+   a string's or symbol's bytes are at a in the chars, b long. */
+struct cell {
+  kind k = kind::nil;
+  std::uint32_t a = 0, b = 0;
+  std::int64_t i = 0;
+};
+
+/* The id of the symbol named s: the same in every tree, and at run time. */
+constexpr std::uint64_t symbol_id(std::string_view s)
+{
+  std::uint64_t h = 0xcbf29ce484222325ULL;
+  for ( char c : s )
+    h = (h ^ (unsigned char) c) * 0x100000001b3ULL;
+  return h;
+}
+
+/* A value in a tree. */
+class value {
+  const cell *cells_;
+  const char *chars_;
+  std::uint32_t i_;
+  constexpr const cell &c() const { return cells_[i_]; }
+public:
+  constexpr value(const cell *cells, const char *chars, std::uint32_t i) : cells_(cells), chars_(chars), i_(i) { }
+  constexpr ct::kind kind() const { return c().k; }
+  constexpr bool nullQ() const { return c().k == kind::nil; }
+  constexpr bool pairQ() const { return c().k == kind::pair; }
+  constexpr value car() const { return value(cells_, chars_, c().a); }
+  constexpr value cdr() const { return value(cells_, chars_, c().b); }
+  /* The elements of a vector, as a list. */
+  constexpr value elements() const { return value(cells_, chars_, c().a); }
+  constexpr std::int64_t fixnum() const { return c().i; }
+  constexpr int character() const { return (int) c().i; }
+  constexpr std::uint64_t symbol_id() const { return (std::uint64_t) c().i; }
+  /* The bytes of a string or the name of a symbol. */
+  constexpr std::string_view name() const { return std::string_view(chars_ + c().a, c().b); }
+  constexpr bool symbolQ(std::string_view s) const { return c().k == kind::symbol && name() == s; }
+  constexpr bool operator==(const value &x) const { return cells_ == x.cells_ && i_ == x.i_; }
+};
+
+template <std::size_t Cells, std::size_t Chars>
+struct tree {
+  cell cells[Cells];
+  char chars[Chars];
+  std::uint32_t top = 0;
+  constexpr value root() const { return value(cells, chars, top); }
+};
+
+/* Never defined: calling it makes the literal fail to compile. */
+void malformed_literal(const char *why);
+
+/* Reads one datum into cells and chars, or only counts them if they are null. */
+class parser {
+  const char *s_, *end_;
+  cell *cells_;
+  char *chars_;
+  static constexpr std::uint32_t dot = 0xffffffff;
+public:
+  std::uint32_t ncells = 3, nchars = 0;   /* Cells 0, 1 and 2 are (), #t and #f. */
+
+  constexpr parser(const char *s, std::size_t n, cell *cells, char *chars) :
+    s_(s), end_(s + n), cells_(cells), chars_(chars)
+  {
+    if ( cells_ ) {
+      cells_[1].k = kind::t;
+      cells_[2].k = kind::f;
+    }
+  }
+
+  constexpr std::uint32_t read_top()
+  {
+    std::uint32_t x = read_datum();
+    if ( x == dot )
+      malformed_literal("unexpected '.'");
+    while ( eat_whitespace_peekchar() == '#' && s_ + 1 < end_ ) {
+      get();
+      switch ( get() ) {
+      case ';': read_datum(); continue;
+      case '|': skip_block_comment(); continue;
+      case '!':
+        while ( peek() != -1 && peek() != '\n' )
+          get();
+        continue;
+      }
+      malformed_literal("more than one datum");
+    }
+    if ( peek() != -1 )
+      malformed_literal("more than one datum");
+    return x;
+  }
+
+private:
+  static constexpr bool spaceQ(int c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+  static constexpr bool digitQ(int c, int radix)
+  {
+    int d = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'z' ? c - 'a' + 10 : c >= 'A' && c <= 'Z' ? c - 'A' + 10 : 99;
+    return d < radix;
+  }
+  static constexpr bool alphaQ(int c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+  static constexpr bool token_charQ(int c)
+  {
+    return alphaQ(c) || digitQ(c, 10) || c >= 128 || std::string_view("~!@$%&*_+-=:<>^.?/|").find((char) c) != std::string_view::npos;
+  }
+  static constexpr bool macro_terminating_charQ(int c)
+  {
+    return c == -1 || c == ';' || c == '(' || c == ')' || c == '#' || spaceQ(c);
+  }
+  static constexpr bool equal_nocase(std::string_view a, std::string_view b)
+  {
+    if ( a.size() != b.size() )
+      return false;
+    for ( std::size_t i = 0; i < a.size(); ++ i ) {
+      if ( (alphaQ(a[i]) ? a[i] | 0x20 : a[i]) != b[i] )
+        return false;
+    }
+    return true;
+  }
+
+  constexpr int peek() const { return s_ < end_ ? (unsigned char) *s_ : -1; }
+  constexpr int get() { return s_ < end_ ? (unsigned char) *s_ ++ : -1; }
+
+  constexpr std::uint32_t add(cell c)
+  {
+    if ( cells_ )
+      cells_[ncells] = c;
+    return ncells ++;
+  }
+  constexpr void set_cdr(std::uint32_t p, std::uint32_t x)
+  {
+    if ( cells_ )
+      cells_[p].b = x;
+  }
+  constexpr void add_char(char c)
+  {
+    if ( chars_ )
+      chars_[nchars] = c;
+    ++ nchars;
+  }
+
+  constexpr int eat_whitespace_peekchar()
+  {
+    while ( 1 ) {
+      while ( spaceQ(peek()) )
+        get();
+      if ( peek() != ';' )
+        return peek();
+      while ( peek() != -1 && peek() != '\n' )
+        get();
+    }
+  }
+
+  constexpr std::uint32_t cons(std::uint32_t a, std::uint32_t d)
+  {
+    cell c;
+    c.k = kind::pair;
+    c.a = a;
+    c.b = d;
+    return add(c);
+  }
+
+  constexpr std::uint32_t read_datum()
+  {
+    while ( 1 ) {
+      int c = eat_whitespace_peekchar();
+      if ( c == -1 )
+        malformed_literal("eos");
+      get();
+      switch ( c ) {
+      case '\'': return quote("quote");
+      case '`': return quote("quasiquote");
+      case ',':
+        if ( peek() == '@' ) {
+          get();
+          return quote("unquote-splicing");
+        }
+        return quote("unquote");
+      case '(':
+        return read_list();
+      case '"':
+        return read_string();
+      case '#':
+        switch ( c = get() ) {
+        case ';': read_datum(); continue;
+        case '|': skip_block_comment(); continue;
+        case '!':
+          while ( peek() != -1 && peek() != '\n' )
+            get();
+          continue;
+        case '(': {
+          cell v;
+          v.k = kind::vector;
+          -- s_;
+          v.a = read_datum();
+          return add(v);
+        }
+        case 't': case 'T': return 1;
+        case 'f': case 'F': return 2;
+        case '\\': return read_char();
+        case 'b': case 'B': return read_token(2, true);
+        case 'o': case 'O': return read_token(8, true);
+        case 'd': case 'D': return read_token(10, true);
+        case 'x': case 'X': return read_token(16, true);
+        }
+        malformed_literal("bad sequence after '#'");
+      case ')':
+        malformed_literal("unexpected ')'");
+      }
+      if ( ! token_charQ(c) )
+        malformed_literal("unexpected character");
+      -- s_;
+      return read_token(10, false);
+    }
+  }
+
+  constexpr std::uint32_t quote(std::string_view name)
+  {
+    std::uint32_t sym = symbol(name.data(), name.size());
+    std::uint32_t x = read_datum();
+    if ( x == dot )
+      malformed_literal("unexpected '.'");
+    return cons(sym, cons(x, 0));
+  }
+
+  constexpr std::uint32_t read_list()
+  {
+    std::uint32_t head = 0, last = 0;
+    while ( 1 ) {
+      int c = eat_whitespace_peekchar();
+      if ( c == -1 )
+        malformed_literal("eos in list");
+      if ( c == ')' ) {
+        get();
+        return head;
+      }
+      std::uint32_t x = read_datum();
+      if ( x == dot ) {
+        if ( ! head )
+          malformed_literal("expected something before '.' in list");
+        x = read_datum();
+        if ( x == dot )
+          malformed_literal("unexpected '.'");
+        set_cdr(last, x);
+        if ( eat_whitespace_peekchar() != ')' )
+          malformed_literal("expected ')' after the cdr of a '.' list");
+        get();
+        return head;
+      }
+      std::uint32_t p = cons(x, 0);
+      if ( head )
+        set_cdr(last, p);
+      else
+        head = p;
+      last = p;
+    }
+  }
+
+  constexpr void skip_block_comment()
+  {
+    int level = 1, c;
+    while ( level > 0 && (c = get()) != -1 ) {
+      if ( c == '|' && peek() == '#' ) {
+        get();
+        -- level;
+      } else if ( c == '#' && peek() == '|' ) {
+        get();
+        ++ level;
+      }
+    }
+    if ( level > 0 )
+      malformed_literal("eos inside #| comment |#");
+  }
+
+  constexpr std::uint32_t read_char()
+  {
+    cell x;
+    int c = get();
+    x.k = kind::character;
+    if ( c == -1 )
+      malformed_literal("eos after '#\\'");
+    const char *start = s_ - 1;
+    bool hex = (c == 'x' || c == 'X') && digitQ(peek(), 16);
+    if ( alphaQ(c) ) {
+      while ( hex ? digitQ(peek(), 36) : alphaQ(peek()) )
+        get();
+    }
+    std::string_view name(start, s_ - start);
+    if ( name.size() == 1 )
+      x.i = c;
+    else if ( hex ) {
+      if ( (x.i = detail::char_hex(name.substr(1))) < 0 )
+        malformed_literal("bad char");
+    } else {
+      x.i = -1;
+      for ( const detail::char_name &n : detail::char_names ) {
+        if ( n.name && equal_nocase(name, n.name) )
+          x.i = (unsigned char) n.c;
+      }
+      if ( x.i < 0 )
+        malformed_literal("unknown char name");
+    }
+    return add(x);
+  }
+
+  constexpr std::uint32_t read_string()
+  {
+    cell x;
+    int c;
+    x.k = kind::string;
+    x.a = nchars;
+    while ( (c = get()) != '"' ) {
+      if ( c == '\\' ) {
+        switch ( c = get() ) {
+        case 'n': c = '\n'; break;
+        case 't': c = '\t'; break;
+        case 'r': c = '\r'; break;
+        case 'a': c = '\a'; break;
+        case 'b': c = '\b'; break;
+        case '0': c = '\0'; break;
+        }
+      }
+      if ( c == -1 )
+        malformed_literal("EOS in string");
+      add_char((char) c);
+    }
+    x.b = nchars - x.a;
+    add_char('\0');
+    return add(x);
+  }
+
+  constexpr std::uint32_t symbol(const char *p, std::size_t n)
+  {
+    cell x;
+    x.k = kind::symbol;
+    x.a = nchars;
+    x.b = (std::uint32_t) n;
+    x.i = (std::int64_t) symbol_id(std::string_view(p, n));
+    for ( std::size_t i = 0; i < n; ++ i )
+      add_char(p[i]);
+    add_char('\0');
+    return add(x);
+  }
+
+  /* Only integers are read as numbers: there is no constexpr strtod(). */
+  constexpr std::uint32_t read_token(int radix, bool prefixed)
+  {
+    const char *start = s_;
+    while ( ! macro_terminating_charQ(peek()) )
+      get();
+    std::string_view s(start, s_ - start);
+    std::size_t i = s.size() > 1 && (s[0] == '+' || s[0] == '-') ? 1 : 0;
+    bool number = i < s.size();
+    for ( std::size_t j = i; j < s.size(); ++ j )
+      number = number && digitQ(s[j], radix);
+    if ( number ) {
+      cell x;
+      x.k = kind::fixnum;
+      for ( ; i < s.size(); ++ i ) {
+        int c = s[i];
+        x.i = x.i * radix + (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+      }
+      if ( s[0] == '-' )
+        x.i = - x.i;
+      return add(x);
+    }
+    if ( prefixed )
+      malformed_literal("invalid number string");
+    if ( s == "." )
+      return dot;
+    if ( digitQ(s[0], 10) || ((s[0] == '+' || s[0] == '-' || s[0] == '.') && s.size() > 1 && digitQ(s[1], 10)) )
+      malformed_literal("only integer numbers can be read at compile time");
+    return symbol(s.data(), s.size());
+  }
+};
+
+template <std::size_t N>
+struct literal {
+  char s[N];
+  consteval literal(const char (&a)[N]) { for ( std::size_t i = 0; i < N; ++ i ) s[i] = a[i]; }
+};
+
+template <literal S>
+consteval auto read()
+{
+  constexpr auto counts = [] {
+    parser p(S.s, sizeof(S.s) - 1, 0, 0);
+    p.read_top();
+    return std::pair<std::uint32_t, std::uint32_t>(p.ncells, p.nchars);
+  }();
+  tree<counts.first, counts.second ? counts.second : 1> t{};
+  parser p(S.s, sizeof(S.s) - 1, t.cells, t.chars);
+  t.top = p.read_top();
+  return t;
+}
+
+} // namespace ct
+
+namespace literals {
+
+/* static constexpr auto table = "((a 1) (b 2))"_sexp; */
+template <ct::literal S>
+consteval auto operator""_sexp()
+{
+  return ct::read<S>();
+}
+
+} // namespace literals
+
+#endif
+
+} // namespace lispread
+
+#endif
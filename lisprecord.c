@@ -0,0 +1,281 @@
+/*
+** lisprecord.c - readers specialised to one record shape.
+*/
+/*
+Most streams of data have one shape, as in:
+
+  (event 42 click "button 1" (0.5 1.25))
+
+lisprecord.c makes a C function that reads exactly that shape from
+memory straight into the fields of a C struct, without making any VALUE.
+For anything else it returns 0 and leaves the bytes to lispread.c.
+
+Define the following macros and #include "lisprecord.c"; it can be included
+again for another record.
+
+Macro               Implementation
+==========================================================================
+RECORD_DECL         A C function definition: the "p" and "end" variables must
+                    be bound to the const char * bytes to read and the "r"
+                    variable to a pointer to the struct to fill.  The function
+                    returns the const char * after the record, or 0 if the
+                    bytes at p are not one.  Leading whitespace is skipped.
+RECORD_FIELDS(F)    The list elements, in order, as F(KIND, NAME) for:
+
+F(SYMBOL_IS, s)     The symbol s.  It is not stored.
+F(LONG, x)          An integer, into long r->x.
+F(DOUBLE, x)        A number, into double r->x.
+F(SYMBOL, x)        A symbol, into char r->x[], NUL terminated.
+F(STRING, x)        A string, into char r->x[], NUL terminated.  Escapes are
+                    replaced as by lv_escape_string().
+F(LONGS, x)         A list of integers, into long r->x[], and their count
+                    into size_t r->x_n.
+F(DOUBLES, x)       A list of numbers, into double r->x[], and r->x_n.
+
+A symbol, string or list that does not fit in its array does not match,
+nor do numbers with a #x, etc. prefix, 'x, `x and ,x quotes, |x| symbols,
+#| comments, datum labels and anything else outside the shape.  ';' comments may appear between elements.
+
+  struct event { long id; char kind[16]; char name[64]; double v[8]; size_t v_n; };
+
+  #define RECORD_DECL static const char *read_event(const char *p, const char *end, struct event *r)
+  #define RECORD_FIELDS(F) F(SYMBOL_IS, event) F(LONG, id) F(SYMBOL, kind) F(STRING, name) F(DOUBLES, v)
+  #include "lisprecord.c"
+
+  if ( (q = read_event(p, end, &ev)) )
+    p = q;
+  else
+    ... read the datum at p with lispread.c ...
+
+*/
+
+#ifndef LISPRECORD_C
+#define LISPRECORD_C
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static
+const char *record_skip(const char *p, const char *end)
+{
+  while ( p < end ) {
+    if ( isspace((unsigned char) *p) )
+      ++ p;
+    else if ( *p == ';' ) {
+      while ( p < end && *p != '\n' )
+	++ p;
+    } else
+      break;
+  }
+  return p;
+}
+
+static
+int record_terminatorQ(const char *p, const char *end)
+{
+  return p == end || *p == ';' || *p == '(' || *p == ')' || *p == '#' || *p == '"' || isspace((unsigned char) *p);
+}
+
+/* Returns the end of the token at P, or 0 if there is none.  lispread.c
+   reads a '"' after a token, as in ab"c", as part of it: so no match. */
+static
+const char *record_token(const char *p, const char *end)
+{
+  const char *q = p;
+
+  while ( ! record_terminatorQ(q, end) )
+    ++ q;
+  return q == p || (q < end && *q == '"') ? 0 : q;
+}
+
+/* Copies the token from P to Q into BUF, NUL terminated. */
+static
+int record_token_copy(const char *p, const char *q, char *buf, size_t size)
+{
+  if ( (size_t) (q - p) >= size )
+    return 0;
+  memcpy(buf, p, q - p);
+  buf[q - p] = '\0';
+  return 1;
+}
+
+static
+const char *record_long(const char *p, const char *end, long *x)
+{
+  char buf[32], *e;
+  const char *q;
+
+  p = record_skip(p, end);
+  if ( ! (q = record_token(p, end)) || ! record_token_copy(p, q, buf, sizeof(buf)) )
+    return 0;
+  errno = 0;
+  *x = strtol(buf, &e, 10);
+  if ( *e || e == buf || errno == ERANGE )
+    return 0;
+  return q;
+}
+
+static
+const char *record_double(const char *p, const char *end, double *x)
+{
+  char buf[64], *e;
+  const char *q;
+
+  p = record_skip(p, end);
+  if ( ! (q = record_token(p, end)) || ! record_token_copy(p, q, buf, sizeof(buf)) )
+    return 0;
+  /* As lv_string_2_number(): +inf.0, -inf.0 and +nan.0 are numbers,
+     "inf", "nan", hex floats and numbers too big for a double symbols. */
+  if ( (*buf == '+' || *buf == '-') && ! strcmp(buf + 1, "inf.0") ) {
+    *x = *buf == '-' ? -HUGE_VAL : HUGE_VAL;
+    return q;
+  }
+  if ( (*buf == '+' || *buf == '-') && ! strcmp(buf + 1, "nan.0") ) {
+    *x = NAN;
+    return q;
+  }
+  e = buf + (*buf == '+' || *buf == '-');
+  e += *e == '.';
+  if ( ! isdigit((unsigned char) *e) || buf[strspn(buf, "0123456789+-.eE")] )
+    return 0;
+  errno = 0;
+  *x = strtod(buf, &e);
+  if ( *e || (errno == ERANGE && (*x == HUGE_VAL || *x == -HUGE_VAL)) )
+    return 0;
+  return q;
+}
+
+static
+const char *record_symbol(const char *p, const char *end, char *buf, size_t size)
+{
+  const char *q;
+  double d;
+
+  p = record_skip(p, end);
+  /* lispread.c reads 'x, `x, ,x, "s" and |s| as something else. */
+  if ( p == end || memchr("'`,\"|", *p, 5) )
+    return 0;
+  if ( ! (q = record_token(p, end)) || record_double(p, end, &d) )
+    return 0;
+  /* Nor is a lone '.' a symbol. */
+  if ( q - p == 1 && *p == '.' )
+    return 0;
+  if ( ! record_token_copy(p, q, buf, size) )
+    return 0;
+  return q;
+}
+
+static
+const char *record_symbol_is(const char *p, const char *end, const char *name)
+{
+  const char *q;
+  size_t len = strlen(name);
+
+  p = record_skip(p, end);
+  if ( ! (q = record_token(p, end)) || (size_t) (q - p) != len || memcmp(p, name, len) )
+    return 0;
+  return q;
+}
+
+static
+const char *record_string(const char *p, const char *end, char *buf, size_t size)
+{
+  size_t n = 0;
+
+  p = record_skip(p, end);
+  if ( p == end || *p ++ != '"' )
+    return 0;
+  while ( p < end && *p != '"' ) {
+    char c = *p ++;
+    if ( c == '\\' ) {
+      if ( p == end )
+	return 0;
+      switch ( c = *p ++ ) {
+      case 'n': c = '\n'; break;
+      case 't': c = '\t'; break;
+      case 'r': c = '\r'; break;
+      case 'a': c = '\a'; break;
+      case 'b': c = '\b'; break;
+      case '0': c = '\0'; break;
+      }
+    }
+    if ( n + 1 >= size )
+      return 0;
+    buf[n ++] = c;
+  }
+  if ( p == end )
+    return 0;
+  buf[n] = '\0';
+  return p + 1;
+}
+
+static
+const char *record_open(const char *p, const char *end)
+{
+  p = record_skip(p, end);
+  return p < end && *p == '(' ? p + 1 : 0;
+}
+
+static
+const char *record_close(const char *p, const char *end)
+{
+  p = record_skip(p, end);
+  return p < end && *p == ')' ? p + 1 : 0;
+}
+
+static
+const char *record_longs(const char *p, const char *end, long *v, size_t size, size_t *np)
+{
+  const char *q;
+
+  if ( ! (p = record_open(p, end)) )
+    return 0;
+  for ( *np = 0; ! (q = record_close(p, end)); ++ *np ) {
+    if ( *np == size || ! (p = record_long(p, end, &v[*np])) )
+      return 0;
+  }
+  return q;
+}
+
+static
+const char *record_doubles(const char *p, const char *end, double *v, size_t size, size_t *np)
+{
+  const char *q;
+
+  if ( ! (p = record_open(p, end)) )
+    return 0;
+  for ( *np = 0; ! (q = record_close(p, end)); ++ *np ) {
+    if ( *np == size || ! (p = record_double(p, end, &v[*np])) )
+      return 0;
+  }
+  return q;
+}
+
+#define RECORD_FIELD_SYMBOL_IS(F) record_symbol_is(p, end, #F)
+#define RECORD_FIELD_LONG(F)      record_long(p, end, &r->F)
+#define RECORD_FIELD_DOUBLE(F)    record_double(p, end, &r->F)
+#define RECORD_FIELD_SYMBOL(F)    record_symbol(p, end, r->F, sizeof(r->F))
+#define RECORD_FIELD_STRING(F)    record_string(p, end, r->F, sizeof(r->F))
+#define RECORD_FIELD_LONGS(F)     record_longs(p, end, r->F, sizeof(r->F) / sizeof(r->F[0]), &r->F##_n)
+#define RECORD_FIELD_DOUBLES(F)   record_doubles(p, end, r->F, sizeof(r->F) / sizeof(r->F[0]), &r->F##_n)
+#define RECORD_FIELD(KIND,F)      if ( ! (p = RECORD_FIELD_##KIND(F)) ) return 0;
+
+#endif
+
+#ifdef RECORD_DECL
+
+RECORD_DECL
+{
+  if ( ! (p = record_open(p, end)) )
+    return 0;
+  RECORD_FIELDS(RECORD_FIELD)
+  return record_close(p, end);
+}
+
+#undef RECORD_DECL
+#undef RECORD_FIELDS
+
+#endif
@@ -0,0 +1,782 @@
+/*
+** lispvalue.c - a compact reference VALUE model for lispread.c and lispwrite.c.
+*/
+/*
+#include "lispvalue.c" before "lispread.c" and "lispwrite.c" to get
+a complete reader and writer without writing any glue:
+
+  #include "lispvalue.c"
+  #include "lispread.c"
+  #include "lispwrite.c"
+
+  VALUE x;
+  if ( lv_read_file(stdin, &x) == 0 && ! EQ(x, EOS) )
+    lv_write(x, LV_STREAM(stdout));
+
+Each glue macro below can be defined before #include "lispvalue.c" to override it.
+
+A VALUE is a tagged 64-bit word.  The low 4 bits select the representation:
+
+xxx1    Fixnum: a 63-bit signed integer in the high bits.
+0000    NIL, which is 0.
+0010    Pair: a pointer to a 16-byte aligned car/cdr cell, plus 2.
+0100    Object: a pointer to a 16-byte aligned object with a header word, plus 4.
+0110    Immediate: bits 4-7 are a subtype, bits 8-63 its value.
+        Subtype 0 is a character code, subtype 1 is #f, #t, #u, EOS or YIELD.
+1000    Short string: the length (0-7) in bits 4-7, the bytes in bits 8-63.
+1010    Short symbol: the same as a short string.
+1100    Cdr-coded pair: the address of its car, shifted left 1, plus 12.
+
+Short strings and symbols take no memory, and short symbols are EQ
+without a table lookup.  Longer symbols are interned in a hash table.
+lv_intern_static() adds the pre-built symbols of lispread-embed output
+to that table.
+Strings read from literals are immutable.
+
+If LV_CDR_CODING is defined, lists of 3 or more elements read by
+lispread.c are cdr-coded: their cars are stored in one block followed
+by LV_CDR_END and the tail, taking 8 bytes per element instead of 16.
+The CDR of a cdr-coded pair is the next car in the block, until the end
+code.  SET_CDR() of any but the last pair of the block is an error.
+
+Objects are strings, symbols, vectors, flonums and typed vectors.
+The low 8 bits of an object header are its type, the rest its length.
+Integers outside the fixnum range are read as flonums; there are no bignums.
+
+Pairs and objects are allocated from LV_CHUNK_SIZE byte chunks.
+There is no garbage collector: lv_reset() frees everything at once.
+
+ERROR() records the message in lv_error_message and longjmp()s to the
+lv_read_file() in progress, which resets the reader and returns -1.
+With READ_YIELD, lv_read_file() may set *XP to YIELD: call it again
+to continue the same datum.
+
+*/
+
+#ifndef LISPVALUE_C
+#define LISPVALUE_C
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <errno.h>
+#include <ctype.h>
+#include <math.h> /* isinf(), isnan() */
+
+typedef uint64_t VALUE;
+
+#define LV_TAG(X)       ((X) & 0xf)
+#define LV_PAIR_TAG     0x2
+#define LV_OBJECT_TAG   0x4
+#define LV_IMM_TAG      0x6
+#define LV_SSTRING_TAG  0x8
+#define LV_SSYMBOL_TAG  0xa
+
+#define LV_IMM(T,V)     (((VALUE) (V) << 8) | ((T) << 4) | LV_IMM_TAG)
+#define LV_IMM_TYPE(X)  (((X) >> 4) & 0xf)
+#define LV_IMM_CHAR     0
+#define LV_IMM_CONST    1
+
+#define LV_NIL          ((VALUE) 0)
+#define LV_F            LV_IMM(LV_IMM_CONST, 0)
+#define LV_T            LV_IMM(LV_IMM_CONST, 1)
+#define LV_U            LV_IMM(LV_IMM_CONST, 2)
+#define LV_EOS          LV_IMM(LV_IMM_CONST, 3)
+#define LV_YIELD        LV_IMM(LV_IMM_CONST, 4)
+
+#define LV_FIXNUMQ(X)   ((X) & 1)
+#define LV_FIXNUM(N)    (((VALUE) (int64_t) (N) << 1) | 1)
+#define LV_FIXNUM_VALUE(X) ((int64_t) (X) >> 1)
+#define LV_FIXNUM_MIN   (INT64_MIN >> 1)
+#define LV_FIXNUM_MAX   (INT64_MAX >> 1)
+
+#define LV_CHARQ(X)     (LV_TAG(X) == LV_IMM_TAG && LV_IMM_TYPE(X) == LV_IMM_CHAR)
+#define LV_CHAR(C)      LV_IMM(LV_IMM_CHAR, (uint32_t) (C))
+#define LV_CHAR_VALUE(X) ((int) ((X) >> 8))
+
+#define LV_SHORT_MAX    7
+#define LV_SHORT_LEN(X) (((X) >> 4) & 0xf)
+
+struct lv_pair {
+  VALUE car, cdr;
+};
+
+#define LV_PAIR(X)      ((struct lv_pair*) (uintptr_t) ((X) - LV_PAIR_TAG))
+
+#define LV_CPAIR_TAG    0xc
+#define LV_CPAIR(X)     ((VALUE*) (uintptr_t) (((X) - LV_CPAIR_TAG) >> 1))
+#define LV_CDR_END      LV_IMM(LV_IMM_CONST, 0xff)
+
+#define LV_PAIRQ(X)     (LV_TAG(X) == LV_PAIR_TAG || LV_TAG(X) == LV_CPAIR_TAG)
+
+enum lv_type {
+  LV_STRING = 1,
+  LV_SYMBOL,
+  LV_VECTOR,
+  LV_FLONUM,
+  LV_TYPED_VECTOR,
+};
+
+struct lv_object {
+  uint64_t header;      /* length << 8 | enum lv_type */
+};
+
+#define LV_OBJECTQ(X)   (LV_TAG(X) == LV_OBJECT_TAG)
+#define LV_OBJECT(X)    ((struct lv_object*) (uintptr_t) ((X) - LV_OBJECT_TAG))
+#define LV_TYPE(X)      (LV_OBJECT(X)->header & 0xff)
+#define LV_LENGTH(X)    ((size_t) (LV_OBJECT(X)->header >> 8))
+#define LV_TYPEQ(X,T)   (LV_OBJECTQ(X) && LV_TYPE(X) == (T))
+
+struct lv_string {
+  uint64_t header;
+  char data[];          /* NUL terminated. */
+};
+
+struct lv_symbol {
+  uint64_t header;
+  struct lv_symbol *next;
+  uint64_t hash;
+  char name[];          /* NUL terminated. */
+};
+
+struct lv_vector {
+  uint64_t header;
+  VALUE v[];
+};
+
+struct lv_flonum {
+  uint64_t header;
+  double d;
+};
+
+struct lv_typed_vector {
+  uint64_t header;      /* Length in elements. */
+  int kind;             /* enum typed_vector_kind from lispread.c. */
+  struct lv_typed_vector *next;
+  void *data;           /* MALLOCed by the reader. */
+};
+
+#ifndef LV_CHUNK_SIZE
+#define LV_CHUNK_SIZE (256 * 1024)
+#endif
+
+static struct lv_chunk {
+  struct lv_chunk *next;
+  char *p, *end;
+} *lv_chunks;
+static size_t lv_allocated;
+static struct lv_typed_vector *lv_typed_vectors;
+static struct lv_symbol **lv_symbols;
+static size_t lv_symbols_size, lv_symbols_n;
+
+static char lv_error_message[256];
+static jmp_buf *lv_error_jmp;
+
+/* Returns SIZE bytes, 16-byte aligned. */
+static
+void *lv_alloc(size_t size)
+{
+  struct lv_chunk *c = lv_chunks;
+  void *p;
+
+  size = (size + 15) & ~(size_t) 15;
+  lv_allocated += size;
+  if ( ! c || (size_t) (c->end - c->p) < size ) {
+    size_t csize = size > LV_CHUNK_SIZE / 4 ? size + 16 : LV_CHUNK_SIZE;
+    c = malloc(sizeof(*c) + csize + 16);
+    if ( ! c )
+      abort();
+    c->p = (char*) (((uintptr_t) (c + 1) + 15) & ~(uintptr_t) 15);
+    c->end = c->p + csize;
+    /* Keep allocating from the fuller chunk after a large object. */
+    if ( lv_chunks && csize != LV_CHUNK_SIZE ) {
+      c->next = lv_chunks->next;
+      lv_chunks->next = c;
+    } else {
+      c->next = lv_chunks;
+      lv_chunks = c;
+    }
+  }
+  p = c->p;
+  c->p += size;
+  return p;
+}
+
+#if defined(READ_STRING_CACHE) || defined(READ_HASH_CONS)
+static inline void string_cache_clear(void);
+#endif
+#ifdef READ_HASH_CONS
+static inline void hash_cons_clear(void);
+#endif
+
+/* Frees every pair, object and symbol, and empties the reader's caches
+   of them. */
+static
+void lv_reset(void)
+{
+#if defined(READ_STRING_CACHE) || defined(READ_HASH_CONS)
+  string_cache_clear();
+#endif
+#ifdef READ_HASH_CONS
+  hash_cons_clear();
+#endif
+  while ( lv_typed_vectors ) {
+    struct lv_typed_vector *t = lv_typed_vectors;
+    lv_typed_vectors = t->next;
+    free(t->data);
+  }
+  while ( lv_chunks ) {
+    struct lv_chunk *c = lv_chunks;
+    lv_chunks = c->next;
+    free(c);
+  }
+  free(lv_symbols);
+  lv_symbols = 0;
+  lv_symbols_size = lv_symbols_n = 0;
+  lv_allocated = 0;
+}
+
+static
+VALUE lv_cons(VALUE a, VALUE d)
+{
+  struct lv_pair *p = lv_alloc(sizeof(*p));
+  p->car = a;
+  p->cdr = d;
+  return (VALUE) (uintptr_t) p + LV_PAIR_TAG;
+}
+
+#ifdef LV_CDR_CODING
+
+/* Returns the N VALUEs at P followed by TAIL, cdr-coded if N > 2. */
+static
+VALUE lv_make_list(const VALUE *p, size_t n, VALUE tail)
+{
+  VALUE *b;
+
+  if ( n < 3 ) {
+    while ( n > 0 )
+      tail = lv_cons(p[-- n], tail);
+    return tail;
+  }
+  b = lv_alloc((n + 2) * sizeof(VALUE));
+  memcpy(b, p, n * sizeof(VALUE));
+  b[n] = LV_CDR_END;
+  b[n + 1] = tail;
+  return ((VALUE) (uintptr_t) b << 1) + LV_CPAIR_TAG;
+}
+
+#endif
+
+static inline
+VALUE lv_car(VALUE x)
+{
+  if ( LV_TAG(x) == LV_CPAIR_TAG )
+    return LV_CPAIR(x)[0];
+  return LV_PAIR(x)->car;
+}
+
+static inline
+VALUE lv_cdr(VALUE x)
+{
+  if ( LV_TAG(x) == LV_CPAIR_TAG ) {
+    VALUE *p = LV_CPAIR(x);
+    /* The next car is 8 bytes on: 16 in the shifted address. */
+    return p[1] == LV_CDR_END ? p[2] : x + 16;
+  }
+  return LV_PAIR(x)->cdr;
+}
+
+static
+VALUE lv_short(int tag, const char *p, size_t len)
+{
+  VALUE x = (VALUE) len << 4 | tag;
+  size_t i;
+  for ( i = 0; i < len; ++ i )
+    x |= (VALUE) (unsigned char) p[i] << (8 * (i + 1));
+  return x;
+}
+
+/* Returns the bytes of a string or symbol; TMP holds those of short ones. */
+static
+const char *lv_bytes(VALUE x, char tmp[8], size_t *lenp)
+{
+  size_t i;
+
+  switch ( LV_TAG(x) ) {
+  case LV_SSTRING_TAG: case LV_SSYMBOL_TAG:
+    *lenp = LV_SHORT_LEN(x);
+    for ( i = 0; i < 8; ++ i )
+      tmp[i] = i < *lenp ? (char) (x >> (8 * (i + 1))) : 0;
+    return tmp;
+  case LV_OBJECT_TAG:
+    *lenp = LV_LENGTH(x);
+    if ( LV_TYPE(x) == LV_SYMBOL )
+      return ((struct lv_symbol*) LV_OBJECT(x))->name;
+    return ((struct lv_string*) LV_OBJECT(x))->data;
+  }
+  *lenp = 0;
+  return 0;
+}
+
+static
+VALUE lv_make_string(const char *p, size_t len)
+{
+  struct lv_string *s;
+
+  if ( len <= LV_SHORT_MAX )
+    return lv_short(LV_SSTRING_TAG, p, len);
+  s = lv_alloc(sizeof(*s) + len + 1);
+  s->header = (uint64_t) len << 8 | LV_STRING;
+  memcpy(s->data, p, len);
+  s->data[len] = '\0';
+  return (VALUE) (uintptr_t) s + LV_OBJECT_TAG;
+}
+
+static
+int lv_stringQ(VALUE x)
+{
+  return LV_TAG(x) == LV_SSTRING_TAG || LV_TYPEQ(x, LV_STRING);
+}
+
+static
+int lv_symbolQ(VALUE x)
+{
+  return LV_TAG(x) == LV_SSYMBOL_TAG || LV_TYPEQ(x, LV_SYMBOL);
+}
+
+static
+uint64_t lv_hash(const char *p, size_t len)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  size_t i;
+  for ( i = 0; i < len; ++ i )
+    h = (h ^ (unsigned char) p[i]) * 0x100000001b3ULL;
+  return h;
+}
+
+static
+struct lv_symbol *lv_symbol_find(const char *p, size_t len, uint64_t h)
+{
+  struct lv_symbol *s;
+
+  if ( ! lv_symbols )
+    return 0;
+  for ( s = lv_symbols[h & (lv_symbols_size - 1)]; s; s = s->next ) {
+    if ( s->hash == h && LV_LENGTH((VALUE) (uintptr_t) s + LV_OBJECT_TAG) == len && memcmp(s->name, p, len) == 0 )
+      return s;
+  }
+  return 0;
+}
+
+static
+void lv_symbol_add(struct lv_symbol *s)
+{
+  struct lv_symbol **sp;
+  size_t i;
+
+  if ( lv_symbols_n >= lv_symbols_size ) {
+    size_t size = lv_symbols_size ? lv_symbols_size * 2 : 256;
+    struct lv_symbol **table = calloc(size, sizeof(table[0])), *o;
+    for ( i = 0; i < lv_symbols_size; ++ i ) {
+      while ( (o = lv_symbols[i]) ) {
+	lv_symbols[i] = o->next;
+	sp = &table[o->hash & (size - 1)];
+	o->next = *sp;
+	*sp = o;
+      }
+    }
+    free(lv_symbols);
+    lv_symbols = table;
+    lv_symbols_size = size;
+  }
+  sp = &lv_symbols[s->hash & (lv_symbols_size - 1)];
+  s->next = *sp;
+  *sp = s;
+  ++ lv_symbols_n;
+}
+
+static
+VALUE lv_intern(const char *p, size_t len)
+{
+  struct lv_symbol *s;
+  uint64_t h;
+
+  if ( len <= LV_SHORT_MAX )
+    return lv_short(LV_SSYMBOL_TAG, p, len);
+  h = lv_hash(p, len);
+  if ( (s = lv_symbol_find(p, len, h)) )
+    return (VALUE) (uintptr_t) s + LV_OBJECT_TAG;
+  s = lv_alloc(sizeof(*s) + len + 1);
+  s->header = (uint64_t) len << 8 | LV_SYMBOL;
+  s->hash = h;
+  memcpy(s->name, p, len);
+  s->name[len] = '\0';
+  lv_symbol_add(s);
+  return (VALUE) (uintptr_t) s + LV_OBJECT_TAG;
+}
+
+/* Interns the pre-built long symbol X, as made by lispread-embed,
+   unless its name is interned already.  Returns the interned symbol.
+   Inline, as only hosts with lispread-embed output call it. */
+static inline
+VALUE lv_intern_static(VALUE x)
+{
+  struct lv_symbol *s = (struct lv_symbol*) LV_OBJECT(x);
+  struct lv_symbol *o = lv_symbol_find(s->name, LV_LENGTH(x), s->hash);
+
+  if ( o )
+    return (VALUE) (uintptr_t) o + LV_OBJECT_TAG;
+  lv_symbol_add(s);
+  return x;
+}
+
+/* Interns a C identifier with '_' replaced by '-'. */
+static
+VALUE lv_intern_c_name(const char *name)
+{
+  char buf[64];
+  size_t i;
+  for ( i = 0; name[i] && i < sizeof(buf); ++ i )
+    buf[i] = name[i] == '_' ? '-' : name[i];
+  return lv_intern(buf, i);
+}
+
+static
+VALUE lv_make_flonum(double d)
+{
+  struct lv_flonum *f = lv_alloc(sizeof(*f));
+  f->header = LV_FLONUM;
+  f->d = d;
+  return (VALUE) (uintptr_t) f + LV_OBJECT_TAG;
+}
+
+#define LV_FLONUMQ(X)   LV_TYPEQ(X, LV_FLONUM)
+#define LV_FLONUM_VALUE(X) (((struct lv_flonum*) LV_OBJECT(X))->d)
+
+/* Returns a fixnum, a flonum or F. */
+static
+VALUE lv_string_2_number(VALUE x, int radix)
+{
+  char tmp[8], *end;
+  size_t len;
+  const char *p = lv_bytes(x, tmp, &len);
+  const char *q = p;
+  long long n;
+  double d;
+
+  if ( ! p || len == 0 )
+    return LV_F;
+  /* What lv_write_atom() writes for infinities and NaN. */
+  if ( len == 6 && (*p == '+' || *p == '-') ) {
+    if ( memcmp(p + 1, "inf.0", 5) == 0 )
+      return lv_make_flonum(*p == '-' ? -HUGE_VAL : HUGE_VAL);
+    if ( memcmp(p + 1, "nan.0", 5) == 0 )
+      return lv_make_flonum(NAN);
+  }
+  /* Leave "+", "-", "...", "nan", "inf", etc. to be symbols. */
+  if ( *q == '+' || *q == '-' ) ++ q;
+  if ( *q == '.' ) ++ q;
+  if ( ! (isdigit((unsigned char) *q) || (radix == 16 && isxdigit((unsigned char) *q))) )
+    return LV_F;
+  /* strtoll() would skip a "0x" after #x. */
+  if ( radix == 16 && q[0] == '0' && (q[1] == 'x' || q[1] == 'X') )
+    return LV_F;
+
+  errno = 0;
+  n = strtoll(p, &end, radix);
+  if ( end == p + len && errno != ERANGE && n >= LV_FIXNUM_MIN && n <= LV_FIXNUM_MAX )
+    return LV_FIXNUM(n);
+  /* strtod() would read the digits of #b, #o and #x numbers as decimal. */
+  if ( radix != 10 )
+    return end == p + len && errno != ERANGE ? lv_make_flonum((double) n) : LV_F;
+  /* Nor let strtod() read hex floats, "infinity" or "nan(...)". */
+  for ( q = p; q < p + len; ++ q )
+    if ( ! (isdigit((unsigned char) *q) || memchr("+-.eE", *q, 5)) )
+      return LV_F;
+  errno = 0;
+  d = strtod(p, &end);
+  if ( end != p + len || (errno == ERANGE && (d == HUGE_VAL || d == -HUGE_VAL)) )
+    return LV_F;
+  return lv_make_flonum(d);
+}
+
+static
+VALUE lv_list_2_vector(VALUE l)
+{
+  struct lv_vector *v;
+  size_t n = 0;
+  VALUE x;
+
+  for ( x = l; LV_PAIRQ(x); x = lv_cdr(x) )
+    ++ n;
+  v = lv_alloc(sizeof(*v) + n * sizeof(VALUE));
+  v->header = (uint64_t) n << 8 | LV_VECTOR;
+  for ( n = 0, x = l; LV_PAIRQ(x); x = lv_cdr(x) )
+    v->v[n ++] = lv_car(x);
+  return (VALUE) (uintptr_t) v + LV_OBJECT_TAG;
+}
+
+#define LV_VECTORQ(X)   LV_TYPEQ(X, LV_VECTOR)
+#define LV_VECTOR_REF(X,I) (((struct lv_vector*) LV_OBJECT(X))->v[I])
+
+static
+VALUE lv_make_typed_vector(int kind, void *data, size_t n)
+{
+  struct lv_typed_vector *t = lv_alloc(sizeof(*t));
+  t->header = (uint64_t) n << 8 | LV_TYPED_VECTOR;
+  t->kind = kind;
+  t->data = data;
+  t->next = lv_typed_vectors;
+  lv_typed_vectors = t;
+  return (VALUE) (uintptr_t) t + LV_OBJECT_TAG;
+}
+
+/* Replaces the \\ escapes of a string literal. */
+static
+VALUE lv_escape_string(VALUE x)
+{
+  char tmp[8], *buf;
+  size_t len, i, j;
+  const char *p = lv_bytes(x, tmp, &len);
+
+  if ( ! memchr(p, '\\', len) )
+    return x;
+  buf = malloc(len);
+  for ( i = j = 0; i < len; ++ i ) {
+    char c = p[i];
+    if ( c == '\\' && i + 1 < len ) {
+      switch ( c = p[++ i] ) {
+      case 'n': c = '\n'; break;
+      case 't': c = '\t'; break;
+      case 'r': c = '\r'; break;
+      case 'a': c = '\a'; break;
+      case 'b': c = '\b'; break;
+      case '0': c = '\0'; break;
+      }
+    }
+    buf[j ++] = c;
+  }
+  x = lv_make_string(buf, j);
+  free(buf);
+  return x;
+}
+
+static
+VALUE lv_error(const char *format, ...)
+{
+  va_list vap;
+  va_start(vap, format);
+  vsnprintf(lv_error_message, sizeof(lv_error_message), format, vap);
+  va_end(vap);
+  if ( lv_error_jmp )
+    longjmp(*lv_error_jmp, 1);
+  fprintf(stderr, "lispread: %s\n", lv_error_message);
+  abort();
+  return LV_EOS;
+}
+
+static
+void lv_set_car(VALUE x, VALUE v)
+{
+  if ( LV_TAG(x) == LV_CPAIR_TAG )
+    LV_CPAIR(x)[0] = v;
+  else
+    LV_PAIR(x)->car = v;
+}
+
+static
+void lv_set_cdr(VALUE x, VALUE v)
+{
+  if ( LV_TAG(x) == LV_CPAIR_TAG ) {
+    VALUE *p = LV_CPAIR(x);
+    if ( p[1] != LV_CDR_END )
+      lv_error("set-cdr! of a cdr-coded pair");
+    p[2] = v;
+  } else {
+    LV_PAIR(x)->cdr = v;
+  }
+}
+
+#define LV_STREAM(FP)   ((VALUE) (uintptr_t) (FP))
+#define LV_FILE(S)      ((FILE*) (uintptr_t) (S))
+
+/* WRITE_ATOM() for lispwrite.c; inline, so hosts without it are not warned. */
+static inline
+void lv_write_atom(VALUE stream, VALUE x)
+{
+  FILE *fp = LV_FILE(stream);
+  char tmp[8];
+  size_t len, i;
+  const char *p;
+
+  if ( LV_FIXNUMQ(x) ) {
+    fprintf(fp, "%lld", (long long) LV_FIXNUM_VALUE(x));
+  } else if ( x == LV_NIL ) {
+    fputs("()", fp);
+  } else if ( x == LV_F ) {
+    fputs("#f", fp);
+  } else if ( x == LV_T ) {
+    fputs("#t", fp);
+  } else if ( x == LV_U ) {
+    fputs("#u", fp);
+  } else if ( x == LV_EOS ) {
+    fputs("#<eos>", fp);
+  } else if ( LV_CHARQ(x) ) {
+    int c = LV_CHAR_VALUE(x);
+    const char *name = c == ' ' ? "space" : c == '\n' ? "newline" : c == '\t' ? "tab" : c == '\r' ? "return"
+      : c == 0 ? "null" : c == '\a' ? "alarm" : c == '\b' ? "backspace" : c == 0x1b ? "escape" : c == 0x7f ? "delete" : 0;
+    if ( name ) fprintf(fp, "#\\%s", name);
+    else if ( c < ' ' ) fprintf(fp, "#\\x%x", c);
+    else if ( c < 0x80 ) fprintf(fp, "#\\%c", c);
+    else {
+      /* UTF-8: a lead byte and n continuation bytes. */
+      static const int lead[] = { 0, 0xc0, 0xe0, 0xf0 };
+      int n = c < 0x800 ? 1 : c < 0x10000 ? 2 : 3;
+      fprintf(fp, "#\\%c", lead[n] | c >> 6 * n);
+      while ( n -- > 0 )
+        putc(0x80 | (c >> 6 * n & 0x3f), fp);
+    }
+  } else if ( lv_symbolQ(x) ) {
+    p = lv_bytes(x, tmp, &len);
+    fwrite(p, 1, len, fp);
+  } else if ( lv_stringQ(x) ) {
+    p = lv_bytes(x, tmp, &len);
+    putc('"', fp);
+    for ( i = 0; i < len; ++ i ) {
+      switch ( p[i] ) {
+      case '"': case '\\': putc('\\', fp); putc(p[i], fp); break;
+      case '\n': fputs("\\n", fp); break;
+      case '\t': fputs("\\t", fp); break;
+      default: putc(p[i], fp);
+      }
+    }
+    putc('"', fp);
+  } else if ( LV_FLONUMQ(x) ) {
+    char buf[32];
+    double d = LV_FLONUM_VALUE(x);
+    if ( isnan(d) ) strcpy(buf, "+nan.0");
+    else if ( isinf(d) ) strcpy(buf, d < 0 ? "-inf.0" : "+inf.0");
+    else {
+      int prec;
+      /* The shortest form that reads back the same. */
+      for ( prec = 15; prec < 17; ++ prec ) {
+	snprintf(buf, sizeof(buf) - 2, "%.*g", prec, d);
+	if ( strtod(buf, 0) == d )
+	  break;
+      }
+      snprintf(buf, sizeof(buf) - 2, "%.*g", prec, d);
+      if ( ! strpbrk(buf, ".e") )
+	strcat(buf, ".0");
+    }
+    fputs(buf, fp);
+  } else if ( LV_TYPEQ(x, LV_TYPED_VECTOR) ) {
+    static const char *tags[] = { "u8", "s8", "u16", "s16", "u32", "s32", "u64", "s64", "f32", "f64" };
+    struct lv_typed_vector *t = (struct lv_typed_vector*) LV_OBJECT(x);
+    fprintf(fp, "#%s(", tags[t->kind]);
+    for ( i = 0; i < LV_LENGTH(x); ++ i ) {
+      if ( i ) putc(' ', fp);
+      switch ( t->kind ) {
+      case 0: fprintf(fp, "%u", ((uint8_t*) t->data)[i]); break;
+      case 1: fprintf(fp, "%d", ((int8_t*) t->data)[i]); break;
+      case 2: fprintf(fp, "%u", ((uint16_t*) t->data)[i]); break;
+      case 3: fprintf(fp, "%d", ((int16_t*) t->data)[i]); break;
+      case 4: fprintf(fp, "%lu", (unsigned long) ((uint32_t*) t->data)[i]); break;
+      case 5: fprintf(fp, "%ld", (long) ((int32_t*) t->data)[i]); break;
+      case 6: fprintf(fp, "%llu", (unsigned long long) ((uint64_t*) t->data)[i]); break;
+      case 7: fprintf(fp, "%lld", (long long) ((int64_t*) t->data)[i]); break;
+      case 8: fprintf(fp, "%.9g", ((float*) t->data)[i]); break;
+      case 9: fprintf(fp, "%.17g", ((double*) t->data)[i]); break;
+      }
+    }
+    putc(')', fp);
+  } else {
+    fprintf(fp, "#<0x%llx>", (unsigned long long) x);
+  }
+}
+
+/* lispread.c and lispwrite.c glue. */
+
+#ifndef READ_DECL
+#define READ_DECL       static VALUE lv_read(VALUE stream)
+#define READ_CALL()     lv_read(stream)
+#endif
+#ifndef GETC
+#define GETC(S)         getc_unlocked(LV_FILE(S))
+#define UNGETC(S,C)     ungetc(C, LV_FILE(S))
+#endif
+#ifndef WRITE_DECL
+#define WRITE_DECL      static void lv_write(VALUE x, VALUE stream)
+#define PUTS(S,STR)     fputs(STR, LV_FILE(S))
+#endif
+#ifndef WRITE_ATOM
+#define WRITE_ATOM(S,X) lv_write_atom(S,X)
+#endif
+
+#define EQ(X,Y)         ((X) == (Y))
+#define NIL             LV_NIL
+#define T               LV_T
+#define F               LV_F
+#define U               LV_U
+#define EOS             LV_EOS
+#define YIELD           LV_YIELD
+#define HASH_VALUE(X)   ((unsigned long) ((X) ^ ((X) >> 21)))
+
+#define CONS(X,Y)       lv_cons(X,Y)
+#ifdef LV_CDR_CODING
+#define MAKE_LIST(P,N,TAIL) lv_make_list(P,N,TAIL)
+#endif
+#define PAIRQ(X)        LV_PAIRQ(X)
+#define CAR(X)          lv_car(X)
+#define CDR(X)          lv_cdr(X)
+#define SET_CAR(X,V)    lv_set_car(X,V)
+#define SET_CDR(X,V)    lv_set_cdr(X,V)
+
+#define MAKE_CHAR(I)    LV_CHAR(I)
+#define STRING(P,S)     lv_make_string(P,S)
+#define STRING_COPIES   1
+#define ESCAPE_STRING(X) lv_escape_string(X)
+#define STRING_2_NUMBER(X,RADIX) lv_string_2_number(X,RADIX)
+#ifndef READ_SYMBOL_TABLE
+#define STRING_2_SYMBOL(X) ({ char _tmp[8]; size_t _len; const char *_p = lv_bytes(X, _tmp, &_len); lv_intern(_p, _len); })
+#define SYMBOL(NAME)    lv_intern_c_name(#NAME)
+#define SYMBOL_DOT      lv_short(LV_SSYMBOL_TAG, ".", 1)
+#endif
+
+#define LIST_2_VECTOR(X) lv_list_2_vector(X)
+#define VECTORQ(X)      LV_VECTORQ(X)
+#define VECTOR_LENGTH(X) LV_LENGTH(X)
+#define VECTOR_REF(X,I) LV_VECTOR_REF(X,I)
+#define VECTOR_SET(X,I,V) (LV_VECTOR_REF(X,I) = (V))
+#define MAKE_TYPED_VECTOR(K,D,N) lv_make_typed_vector(K,D,N)
+#define BRACKET_LISTS   1
+#define READ_DATUM_LABELS 1
+
+#define ERROR(...)      lv_error(__VA_ARGS__)
+
+static VALUE lv_read(VALUE stream);
+struct read_ctx;
+static inline void read_ctx_reset(struct read_ctx *ctx);
+
+static
+int lv_read_file_ctx(FILE *fp, VALUE *xp, struct read_ctx *ctx)
+{
+  jmp_buf jb, *saved = lv_error_jmp;
+
+  if ( setjmp(jb) ) {
+    lv_error_jmp = saved;
+    read_ctx_reset(ctx);
+    return -1;
+  }
+  lv_error_jmp = &jb;
+  *xp = lv_read(LV_STREAM(fp));
+  lv_error_jmp = saved;
+  return 0;
+}
+
+/* Reads one datum from FP into *XP; returns -1 with lv_error_message on error. */
+#define lv_read_file(FP,XP) lv_read_file_ctx(FP, XP, READ_CTX)
+
+#endif
@@ -0,0 +1,229 @@
+/*
+** lispwrite.c - a generic lisp writer.
+*/
+/*
+This lisp writer is the counterpart of lispread.c.
+It writes pairs and vectors itself and leaves all other objects to WRITE_ATOM().
+Pairs and vectors that are reached more than once are written with
+R7RS datum labels, as in "#0=(a . #0#)", so shared and cyclic structure
+can be read back by lispread.c with READ_DATUM_LABELS.
+
+To use lispwrite.c you must defined the following macros and #include "lispwrite.c"
+to "glue" it to your code.  Most of them are the same as for lispread.c.
+
+Macros declared "Opt." are optional.
+
+Macro               Implementation
+==========================================================================
+VALUE               The C type for a lisp value.
+WRITE_DECL          A C function definition for the lisp write function.
+                    Within the body of WRITE_DECL, the "x" variable must
+                    be bound to the VALUE to write and the "stream"
+                    variable must be bound to a VALUE of the output stream.
+WRITE_DECL_END      Terminate the write C function definition.  Opt.
+
+MALLOC(s)           Allocate a character memory buffer from lisp.  Opt.
+FREE(p)             Free a previouly MALLOCed buffer from lisp.  Opt.
+
+PUTS(stream,s)      Write the C string s to the stream.
+WRITE_ATOM(stream,X) Write a VALUE that is not a pair or a vector.
+
+NIL                 The empty list VALUE.
+EQ(X,Y)             Return non-zero C value if (eq? X Y).
+PAIRQ(X)            Return non-zero C value if X is a pair.
+CAR(CONS)           Get the car field of a pair VALUE.
+CDR(CONS)           Get the cdr field of a pair VALUE.
+VECTORQ(X)          Return non-zero C value if X is a vector.  Opt.
+VECTOR_LENGTH(X)    Return the C length of vector X.  For VECTORQ.
+VECTOR_REF(X,I)     Return element I of vector X.  For VECTORQ.
+HASH_VALUE(X)       Return an unsigned long hash of VALUE X.  Opt.
+
+WRITE_NO_LABELS     If defined, do not look for shared structure.  Opt.
+                    Cyclic structure will not terminate.
+
+*/
+
+#ifdef WRITE_DECL
+
+#include <stdio.h> /* sprintf() */
+#include <string.h> /* memset() */
+
+#ifndef MALLOC
+#define MALLOC(S) malloc(S)
+#endif
+
+#ifndef FREE
+#define FREE(P) free(P)
+#endif
+
+#ifndef HASH_VALUE
+#define HASH_VALUE(X) ((unsigned long) (size_t) (X))
+#endif
+
+#ifdef VECTORQ
+#define WRITE_NODEQ(X) (PAIRQ(X) || VECTORQ(X))
+#else
+#define WRITE_NODEQ(X) PAIRQ(X)
+#endif
+
+/* Every pair and vector reached: how often, and its label once written. */
+struct write_node {
+  VALUE x;
+  unsigned long count;
+  long label;
+};
+
+struct write_ctx {
+  struct write_node *nodes;
+  size_t nodes_size, nodes_n;
+  long next_label;
+};
+
+#ifndef WRITE_NO_LABELS
+
+static
+struct write_node *write_node_find(struct write_ctx *ctx, VALUE x, int create)
+{
+  size_t i;
+
+  if ( create && ctx->nodes_n * 2 >= ctx->nodes_size ) {
+    struct write_node *old = ctx->nodes;
+    size_t old_size = ctx->nodes_size;
+    ctx->nodes_size = old_size ? old_size * 2 : 64;
+    ctx->nodes = memset(MALLOC(ctx->nodes_size * sizeof(*old)), 0, ctx->nodes_size * sizeof(*old));
+    for ( i = 0; i < old_size; ++ i ) {
+      if ( old[i].count )
+	*write_node_find(ctx, old[i].x, 0) = old[i];
+    }
+    if ( old )
+      FREE(old);
+  }
+  if ( ! ctx->nodes )
+    return 0;
+  for ( i = HASH_VALUE(x) * 0x9e3779b97f4a7c15UL >> 7; ; ++ i ) {
+    struct write_node *n = &ctx->nodes[i & (ctx->nodes_size - 1)];
+    if ( ! n->count ) {
+      if ( ! create )
+	return n;
+      n->x = x;
+      n->label = -1;
+      ++ ctx->nodes_n;
+      return n;
+    }
+    if ( EQ(n->x, x) )
+      return n;
+  }
+}
+
+/* Counts how many times each pair and vector is reached from X. */
+static
+void write_count(struct write_ctx *ctx, VALUE x)
+{
+  while ( WRITE_NODEQ(x) ) {
+    struct write_node *n = write_node_find(ctx, x, 1);
+    if ( n->count ++ )
+      return;
+#ifdef VECTORQ
+    if ( VECTORQ(x) ) {
+      size_t i, len = VECTOR_LENGTH(x);
+      for ( i = 0; i < len; ++ i )
+	write_count(ctx, VECTOR_REF(x, i));
+      return;
+    }
+#endif
+    write_count(ctx, CAR(x));
+    x = CDR(x);
+  }
+}
+
+/* Returns 1 if X was written as "#n#", otherwise writes "#n=" if X is shared. */
+static
+int write_label(struct write_ctx *ctx, VALUE stream, VALUE x)
+{
+  struct write_node *n = write_node_find(ctx, x, 0);
+  char buf[32];
+
+  if ( n->count < 2 )
+    return 0;
+  if ( n->label >= 0 ) {
+    sprintf(buf, "#%ld#", n->label);
+    PUTS(stream, buf);
+    return 1;
+  }
+  n->label = ctx->next_label ++;
+  sprintf(buf, "#%ld=", n->label);
+  PUTS(stream, buf);
+  return 0;
+}
+
+/* Returns 1 if X is shared and must not be written as the rest of a list. */
+static
+int write_sharedQ(struct write_ctx *ctx, VALUE x)
+{
+  return write_node_find(ctx, x, 0)->count > 1;
+}
+
+#else
+
+#define write_count(CTX,X) ((void) 0)
+#define write_label(CTX,S,X) 0
+#define write_sharedQ(CTX,X) 0
+
+#endif
+
+static
+void write_value(struct write_ctx *ctx, VALUE stream, VALUE x)
+{
+  if ( ! WRITE_NODEQ(x) ) {
+    WRITE_ATOM(stream, x);
+    return;
+  }
+  if ( write_label(ctx, stream, x) )
+    return;
+#ifdef VECTORQ
+  if ( VECTORQ(x) ) {
+    size_t i, len = VECTOR_LENGTH(x);
+    PUTS(stream, "#(");
+    for ( i = 0; i < len; ++ i ) {
+      if ( i )
+	PUTS(stream, " ");
+      write_value(ctx, stream, VECTOR_REF(x, i));
+    }
+    PUTS(stream, ")");
+    return;
+  }
+#endif
+  PUTS(stream, "(");
+  while ( 1 ) {
+    write_value(ctx, stream, CAR(x));
+    x = CDR(x);
+    if ( EQ(x, NIL) )
+      break;
+    if ( ! PAIRQ(x) || write_sharedQ(ctx, x) ) {
+      PUTS(stream, " . ");
+      write_value(ctx, stream, x);
+      break;
+    }
+    PUTS(stream, " ");
+  }
+  PUTS(stream, ")");
+}
+
+WRITE_DECL
+{
+  struct write_ctx ctx;
+
+  memset(&ctx, 0, sizeof(ctx));
+  write_count(&ctx, x);
+  write_value(&ctx, stream, x);
+#ifndef WRITE_NO_LABELS
+  if ( ctx.nodes )
+    FREE(ctx.nodes);
+#endif
+}
+
+#ifdef WRITE_DECL_END
+WRITE_DECL_END
+#endif
+
+#endif
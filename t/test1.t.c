@@ -16,7 +16,8 @@ static struct alloc {
   size_t size;
   void *realloc_of;
   int live;
-} allocs[1024];
+  int type;
+} allocs[16384];
 static int allocs_n;
 
 static
@@ -24,17 +25,17 @@ struct alloc *find_alloc(void *p)
 {
   int i;
   for ( i = 0; i < allocs_n; ++ i ) {
-    if ( allocs[i].ptr == p )
+    if ( allocs[i].live && allocs[i].ptr == p )
       return &allocs[i];
   }
   return 0;
 }
 
 static
-void *alloc_id(void *p)
+unsigned long alloc_id(void *p)
 {
   struct alloc *a = find_alloc(p);
-  return a ? (void*) (a->id + 32768) : p;
+  return a ? (unsigned long) (a->id + 32768) : (unsigned long) p;
 }
 
 #define P(x) alloc_id((void*) x)
@@ -47,27 +48,27 @@ void *test_malloc(size_t s)
   allocs[allocs_n].ptr  = p;
   allocs[allocs_n].size = s;
   allocs[allocs_n].live = 1; 
+  allocs[allocs_n].type = 0; 
   ++ allocs_n;
-  printf("MALLOC(%ld) => %p\n", (unsigned long) s, P(p));
+  printf("MALLOC(%ld) => 0x%lx\n", (unsigned long) s, P(p));
   return p;
 }
 
 static
 void *test_realloc(void *p, size_t s)
 {
-  void *pn = realloc(p, s);
+  /* Always move, so the trace does not depend on the libc realloc(). */
   struct alloc *a = find_alloc(p);
-  if ( p == pn ) {
-    a->ptr = pn;
-    a->size = s;
-  } else {
-    allocs[allocs_n].id   = allocs_n + 1;
-    allocs[allocs_n].ptr  = pn;
-    allocs[allocs_n].size = s;
-    allocs[allocs_n].live = 1; 
-    ++ allocs_n;
-  }
-  if ( p != pn ) printf("REALLOC(%p,%ld) => %p\n", P(p), (unsigned long) s, P(pn));
+  void *pn = memcpy(malloc(s), p, a->size < s ? a->size : s);
+  allocs[allocs_n].id   = allocs_n + 1;
+  allocs[allocs_n].ptr  = pn;
+  allocs[allocs_n].size = s;
+  allocs[allocs_n].live = 1; 
+  ++ allocs_n;
+  printf("REALLOC(0x%lx,%ld) => 0x%lx\n", P(p), (unsigned long) s, P(pn));
+  a->live = 0;
+  a->ptr = 0;
+  free(p);
   return pn;
 }
 
@@ -75,9 +76,9 @@ static
 void test_free(void *p)
 {
   struct alloc *a = find_alloc(p);
+  printf("FREE(0x%lx)\n", P(p));
   a->live = 0;
   a->ptr = 0;
-  printf("FREE(%p)\n", P(p));
   free(p);
 }
 
@@ -85,7 +86,7 @@ static
 VALUE make_string(const char *p, size_t s)
 {
   void *o = memcpy(test_malloc(s + 1), p, s + 1);
-  printf("STRING(%s,%lu) => %p\n", p, s, P(o));
+  printf("STRING(%s,%lu) => 0x%lx\n", p, s, P(o));
   return o;
 }
 
@@ -112,10 +113,10 @@ VALUE string_2_symbol(VALUE x)
       return (VALUE) symbols[i].name;
     }
   }
-  s = strcpy(test_malloc(strlen(s)), s);
+  s = strcpy(test_malloc(strlen(s) + 1), s);
   symbols[i].id = ++ symbols_n;
   symbols[i].name = s;
-  printf("STRING_2_SYMBOL(%s) => %p\n", s, P(s));
+  printf("STRING_2_SYMBOL(%s) => 0x%lx\n", s, P(s));
   return (VALUE) s;
 }
 
@@ -125,7 +126,7 @@ VALUE string_2_number(VALUE x, int radix)
   char *s = x, *se = 0;
   int n = strtol(s, &se, radix);
   x = se && *se == 0 ? (VALUE) (n + 8192) : F;
-  printf("STRING_2_NUMBER(%s) => %p\n", s, P(x));
+  printf("STRING_2_NUMBER(%s) => 0x%lx\n", s, P(x));
   return x;
 }
 
@@ -134,22 +135,23 @@ static
 VALUE cons(VALUE a, VALUE d)
 {
   struct pair *p = test_malloc(sizeof(*p));
+  find_alloc(p)->type = 'p';
   p->car = a;
   p->cdr = d;
-  printf("CONS(%p,%p) => %p\n", P(a), P(d), P(p));
+  printf("CONS(0x%lx,0x%lx) => 0x%lx\n", P(a), P(d), P(p));
   return p;
 }
 static
 VALUE car(struct pair *p)
 {
-  printf("CAR(%p)\n", P(p));
+  printf("CAR(0x%lx)\n", P(p));
   return p->car;
 }
 
 static
 void set_cdr(struct pair *p, VALUE v)
 {
-  printf("SET_CDR(%p,%p)\n", P(p), P(v));
+  printf("SET_CDR(0x%lx,0x%lx)\n", P(p), P(v));
   p->cdr = v;
 }
 
@@ -162,19 +164,48 @@ void set_cdr(struct pair *p, VALUE v)
 #define REALLOC(P,S) test_realloc(P,S)
 #define FREE(P)      test_free(P)
 #define CONS(X,Y)    cons(X,Y)
-#define CAR(X)       printf("CAR(%p)\n", P(X))
+#define CAR(X)       car(X)
 #define SET_CDR(CONS,V) set_cdr(CONS,V)
 #define MAKE_CHAR(I)    (printf("MAKE_CHAR(%d)\n", I), (VALUE) ((I) + 256))
 #define STRING(P,S)        make_string(P,S)
 #define STRING_2_NUMBER(X,RADIX) string_2_number(X,RADIX)
 #define STRING_2_SYMBOL(X) string_2_symbol(X)
-#define LIST_2_VECTOR(X) (printf("LIST_2_VECTOR(%p)\n", P(X)), X)
+#define LIST_2_VECTOR(X) (printf("LIST_2_VECTOR(0x%lx)\n", P(X)), X)
+#ifndef SYMBOL
 #define SYMBOL(NAME)    string_2_symbol(#NAME)
 #define SYMBOL_DOT      string_2_symbol(".")
+#endif
+#define MAKE_TYPED_VECTOR(K,D,N) make_typed_vector(K,D,N)
+static VALUE make_typed_vector(int kind, void *data, size_t n);
+#define MAKE_TABLE(N)   (printf("MAKE_TABLE(%d)\n", (int) (N)), test_malloc(1))
+#define TABLE_PUT(T,K,V) printf("TABLE_PUT(0x%lx,0x%lx,0x%lx)\n", P(T), P(K), P(V))
 #define BRACKET_LISTS   1
 #define ERROR(STR...)      (printf("ERROR: "), printf(STR), abort(), NIL)
 #include "lispread.c"
 
+static
+VALUE make_typed_vector(int kind, void *data, size_t n)
+{
+  size_t i;
+  printf("MAKE_TYPED_VECTOR(%d,0x%lx,%lu) => (", kind, P(data), (unsigned long) n);
+  for ( i = 0; i < n; ++ i ) {
+    switch ( kind ) {
+    case TYPED_VECTOR_U8:  printf(" %u", ((uint8_t*) data)[i]); break;
+    case TYPED_VECTOR_S8:  printf(" %d", ((int8_t*) data)[i]); break;
+    case TYPED_VECTOR_U16: printf(" %u", ((uint16_t*) data)[i]); break;
+    case TYPED_VECTOR_S16: printf(" %d", ((int16_t*) data)[i]); break;
+    case TYPED_VECTOR_U32: printf(" %u", ((uint32_t*) data)[i]); break;
+    case TYPED_VECTOR_S32: printf(" %d", ((int32_t*) data)[i]); break;
+    case TYPED_VECTOR_U64: printf(" %llu", (unsigned long long) ((uint64_t*) data)[i]); break;
+    case TYPED_VECTOR_S64: printf(" %lld", (long long) ((int64_t*) data)[i]); break;
+    case TYPED_VECTOR_F32: printf(" %g", ((float*) data)[i]); break;
+    case TYPED_VECTOR_F64: printf(" %g", ((double*) data)[i]); break;
+    }
+  }
+  printf(" )\n");
+  return data;
+}
+
 int main(int argc, char **argv)
 {
   while ( ! feof(stdin) ) {
@@ -182,7 +213,24 @@ int main(int argc, char **argv)
     printf("================================\n");
     printf("  fpos = %lu\n", (unsigned long) ftell(stdin));
     result = test_read(stdin);
-    printf("  result alloc_id = %p\n", alloc_id(result));
+    printf("  result alloc_id = 0x%lx\n", alloc_id(result));
+#ifdef TEST_WRITE
+    if ( result != EOS ) {
+      printf("  write => ");
+      TEST_WRITE(result);
+      printf("\n");
+    }
+#endif
+#ifdef READ_SYMBOL_TABLE
+    ++ symbol_table_epoch;
+    printf("  symbol_table_reclaim() => %lu\n", (unsigned long) symbol_table_reclaim(symbol_table_epoch - 1));
+#endif
   }
+#ifdef READ_SYMBOL_TABLE
+  printf("  symbol_table_n = %lu, symbol_table_uninterned = %lu\n", (unsigned long) symbol_table_n, symbol_table_uninterned);
+#endif
+#ifdef READ_STRING_CACHE
+  printf("  string_cache_hits = %lu, string_cache_misses = %lu\n", string_cache_hits, string_cache_misses);
+#endif
   return 0;
 }
@@ -0,0 +1,70 @@
+#define TEST_NO_MAIN
+#include "t/test9.t.cc"
+
+#include <sstream>
+
+/* Reads the input through each input adapter, in windows as small as one byte. */
+
+static std::string expected;
+
+template <class Input>
+static void check(const char *name, Input &in)
+{
+  std::ostringstream out;
+  read_all<obj_traits>(out, in, print_obj);
+  std::cout << name << ": " << (out.str() == expected ? "same" : "DIFFERS") << "\n";
+  if ( out.str() != expected )
+    std::cout << out.str();
+}
+
+int main()
+{
+  std::string text((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+  char name[64];
+
+  {
+    std::ostringstream out;
+    lispread::string_input in(text);
+    read_all<obj_traits>(out, in, print_obj);
+    expected = out.str();
+    std::cout << expected;
+  }
+
+  std::FILE *fp = std::tmpfile();
+  std::fwrite(text.data(), 1, text.size(), fp);
+  std::fflush(fp);
+
+  for ( std::size_t size : { 1, 2, 3, 7, 4096 } ) {
+    std::rewind(fp);
+    lispread::file_input in(fp, size);
+    std::snprintf(name, sizeof(name), "file_input %lu", (unsigned long) size);
+    check(name, in);
+  }
+
+  for ( std::size_t size : { 1, 5, 4096 } ) {
+    lseek(fileno(fp), 0, SEEK_SET);
+    lispread::fd_input in(fileno(fp), size);
+    std::snprintf(name, sizeof(name), "fd_input %lu", (unsigned long) size);
+    check(name, in);
+  }
+
+  {
+    lispread::mmap_input in(fileno(fp));
+    check("mmap_input", in);
+  }
+
+  for ( std::size_t size : { 1, 2, 13 } ) {
+    std::vector<struct iovec> iov;
+    for ( std::size_t i = 0; i < text.size(); i += size ) {
+      struct iovec v = { (void*) (text.data() + i), std::min(size, text.size() - i) };
+      iov.push_back(v);
+      iov.push_back(iovec());
+    }
+    lispread::iovec_input in(iov.data(), iov.size());
+    std::snprintf(name, sizeof(name), "iovec_input %lu", (unsigned long) size);
+    check(name, in);
+  }
+
+  std::fclose(fp);
+  return 0;
+}
@@ -0,0 +1,140 @@
+#define TEST_NO_MAIN
+#include "t/test9.t.cc"
+
+#include <fcntl.h>
+#include <sstream>
+
+/* Reads the input in a coroutine, fed a few bytes at a time. */
+
+/* A coroutine that starts at once and is not awaited. */
+struct task {
+  struct promise_type {
+    task get_return_object() { return task(); }
+    std::suspend_never initial_suspend() { return { }; }
+    std::suspend_never final_suspend() noexcept { return { }; }
+    void return_void() { }
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+/* Counts the tokens that reach the Traits. */
+struct counting_traits : obj_traits {
+  static unsigned long tokens;
+  static value string_2_symbol(std::string_view s) { ++ tokens; return obj_traits::string_2_symbol(s); }
+};
+unsigned long counting_traits::tokens;
+
+template <class Traits>
+static task read_async(lispread::async_reader<Traits> &r, std::ostream &out, int &waits)
+{
+  while ( 1 ) {
+    try {
+      obj *x = co_await r.next();
+      if ( x == obj_traits::eos() )
+        break;
+      print_obj(out, x);
+      out << "\n";
+    } catch ( const lispread::error &e ) {
+      out << "ERROR: " << e.what() << "\n";
+    }
+  }
+  out << "eos\n";
+  waits = -1;
+}
+
+int main()
+{
+  std::string text((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+  std::string expected;
+
+  {
+    std::ostringstream out;
+    lispread::string_input in(text);
+    read_all<obj_traits>(out, in, print_obj);
+    expected = out.str() + "eos\n";
+  }
+
+  /* Fed by hand: print where each datum completes. */
+  {
+    lispread::async_reader<obj_traits> r;
+    int waits = 0;
+    read_async(r, std::cout, waits);
+    for ( std::size_t i = 0; i < text.size(); i += 16 ) {
+      std::cout << "; feed " << i << "\n";
+      r.feed(std::string_view(text).substr(i, 16));
+    }
+    std::cout << "; close\n";
+    r.close();
+  }
+
+  /* A long list fed a byte at a time is read once, when it ends. */
+  {
+    std::string list = "(";
+    for ( int i = 0; i < 1000; ++ i )
+      list += "x" + std::to_string(i) + " ";
+    list += ") ";
+    std::ostringstream out;
+    lispread::async_reader<counting_traits> r;
+    int waits = 0;
+    read_async(r, out, waits);
+    for ( char c : list )
+      r.feed(std::string_view(&c, 1));
+    std::cout << "1000 elements a byte at a time: " << counting_traits::tokens << " tokens read\n";
+    r.close();
+  }
+
+  for ( std::size_t size : { 1, 3, 4096 } ) {
+    std::ostringstream out;
+    lispread::async_reader<obj_traits> r;
+    int waits = 0;
+    read_async(r, out, waits);
+    for ( std::size_t i = 0; i < text.size(); i += size )
+      r.feed(std::string_view(text).substr(i, size));
+    r.close();
+    std::cout << "feed " << size << ": " << (out.str() == expected ? "same" : "DIFFERS") << "\n";
+  }
+
+  /* From a pipe, through the event loop. */
+  for ( std::size_t size : { 1, 5, 4096 } ) {
+    std::ostringstream out;
+    lispread::event_loop loop;
+    int fds[2], waits = 0;
+    if ( pipe(fds) < 0 )
+      return 1;
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    lispread::async_reader<obj_traits> r(loop, fds[0]);
+    read_async(r, out, waits);
+    for ( std::size_t i = 0; i < text.size(); i += size ) {
+      if ( write(fds[1], text.data() + i, std::min(size, text.size() - i)) < 0 )
+        return 1;
+      loop.run_once(0);
+    }
+    close(fds[1]);
+    loop.run();
+    close(fds[0]);
+    std::cout << "pipe " << size << ": " << (out.str() == expected ? "same" : "DIFFERS") << "\n";
+    if ( waits != -1 )
+      std::cout << "not at eos\n";
+  }
+
+  /* A reader that is destroyed while waiting is taken off the loop. */
+  {
+    lispread::event_loop loop;
+    int fds[2];
+    if ( pipe(fds) < 0 )
+      return 1;
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    {
+      lispread::async_reader<obj_traits> r(loop, fds[0]);
+      auto a = r.next();
+      if ( ! a.await_ready() )
+        a.await_suspend(std::noop_coroutine());
+    }
+    if ( write(fds[1], "(a b) ", 6) < 0 )
+      return 1;
+    std::cout << "destroyed reader: " << (loop.run_once(0) ? "still waiting" : "nothing waiting") << "\n";
+    close(fds[0]);
+    close(fds[1]);
+  }
+  return 0;
+}
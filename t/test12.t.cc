@@ -0,0 +1,75 @@
+#define TEST_NO_MAIN
+#include "t/test9.t.cc"
+
+#include <algorithm>
+#include <ranges>
+
+/* Iterates over the datums of the input with lispread::datums(). */
+
+static std::size_t length(obj *x)
+{
+  std::size_t n = 0;
+  for ( ; x->kind == obj::PAIR; x = x->cdr )
+    ++ n;
+  return n;
+}
+
+int main()
+{
+  std::string text((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+  static_assert(std::ranges::input_range<lispread::datum_range<obj_traits, lispread::string_input>>);
+  static_assert(std::ranges::view<lispread::datum_range<obj_traits, lispread::string_input>>);
+
+  std::cout << "+ all\n";
+  {
+    lispread::string_input in(text);
+    for ( auto x : lispread::datums(in, obj_traits()) ) {
+      print_obj(std::cout, x);
+      std::cout << "\n";
+    }
+  }
+
+  std::cout << "+ take(3)\n";
+  {
+    lispread::string_input in(text);
+    for ( auto x : lispread::datums<obj_traits>(in) | std::views::take(3) ) {
+      print_obj(std::cout, x);
+      std::cout << "\n";
+    }
+  }
+
+  std::cout << "+ lengths of lists\n";
+  {
+    lispread::string_input in(text);
+    auto lists = lispread::datums(in, obj_traits())
+      | std::views::filter([](obj *x) { return x->kind == obj::PAIR; })
+      | std::views::transform(length);
+    for ( std::size_t n : lists )
+      std::cout << n << "\n";
+  }
+
+  std::cout << "+ count of symbols\n";
+  {
+    lispread::string_input in(text);
+    std::cout << std::ranges::count_if(lispread::datums(in, obj_traits()), [](obj *x) { return x->kind == obj::SYMBOL; }) << "\n";
+  }
+
+  std::cout << "+ the rest after an error\n";
+  {
+    lispread::string_input in("(a b) (c . ) (d e f)");
+    auto d = lispread::datums(in, obj_traits());
+    try {
+      for ( auto x : d ) {
+        print_obj(std::cout, x);
+        std::cout << "\n";
+      }
+    } catch ( const lispread::error &e ) {
+      std::cout << "ERROR: " << e.what() << "\n";
+    }
+    for ( auto x : d ) {
+      print_obj(std::cout, x);
+      std::cout << "\n";
+    }
+  }
+  return 0;
+}
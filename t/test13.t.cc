@@ -0,0 +1,97 @@
+#include "lispread.hpp"
+
+#include <iostream>
+
+/* Literals read at compile time. */
+
+using namespace lispread::literals;
+using lispread::ct::kind;
+using lispread::ct::symbol_id;
+
+static constexpr auto table = R"(
+  ;; name  code  flags
+  ((alpha  1     (fast "A"))
+   (beta   #x1f  (slow "tab\there"))
+   (gamma  -3    #(#\a #\space #t #f))
+   (delta  #b101 () . tail)
+   '(quoted ,form ,@spliced))
+)"_sexp;
+
+static constexpr auto nested = "#| outer #| inner |# |# (a . (b . (c))) #; skipped"_sexp;
+
+/* Look a code up while compiling. */
+static constexpr long code_of(std::string_view name)
+{
+  for ( auto l = table.root(); l.pairQ(); l = l.cdr() ) {
+    if ( l.car().car().symbolQ(name) )
+      return (long) l.car().cdr().car().fixnum();
+  }
+  return -1;
+}
+
+static_assert(code_of("alpha") == 1);
+static_assert(code_of("beta") == 31);
+static_assert(code_of("gamma") == -3);
+static_assert(code_of("delta") == 5);
+static_assert(code_of("epsilon") == -1);
+static_assert(table.root().car().car().symbol_id() == symbol_id("alpha"));
+static_assert(nested.root().cdr().cdr().car().symbolQ("c"));
+
+static constexpr auto chars = R"((#\tab #\Escape #\x41 #\x3bb #\x))"_sexp;
+static_assert(chars.root().car().character() == '\t');
+static_assert(chars.root().cdr().car().character() == 0x1b);
+static_assert(chars.root().cdr().cdr().car().character() == 'A');
+static_assert(chars.root().cdr().cdr().cdr().car().character() == 0x3bb);
+static_assert(chars.root().cdr().cdr().cdr().cdr().car().character() == 'x');
+
+static void write(lispread::ct::value x)
+{
+  switch ( x.kind() ) {
+  case kind::nil: std::cout << "()"; break;
+  case kind::t: std::cout << "#t"; break;
+  case kind::f: std::cout << "#f"; break;
+  case kind::fixnum: std::cout << x.fixnum(); break;
+  case kind::symbol: std::cout << x.name(); break;
+  case kind::string: std::cout << '"' << x.name() << '"'; break;
+  case kind::character:
+    if ( x.character() == ' ' ) std::cout << "#\\space";
+    else std::cout << "#\\" << (char) x.character();
+    break;
+  case kind::vector:
+    std::cout << "#";
+    write(x.elements());
+    break;
+  case kind::pair:
+    std::cout << "(";
+    while ( 1 ) {
+      write(x.car());
+      x = x.cdr();
+      if ( x.nullQ() )
+        break;
+      if ( ! x.pairQ() ) {
+        std::cout << " . ";
+        write(x);
+        break;
+      }
+      std::cout << " ";
+    }
+    std::cout << ")";
+    break;
+  }
+}
+
+int main()
+{
+  write(table.root());
+  std::cout << "\n";
+  write(nested.root());
+  std::cout << "\n";
+
+  switch ( table.root().cdr().car().car().symbol_id() ) {
+  case symbol_id("alpha"): std::cout << "alpha\n"; break;
+  case symbol_id("beta"): std::cout << "beta\n"; break;
+  default: std::cout << "other\n";
+  }
+  std::cout << sizeof(table.cells) / sizeof(table.cells[0]) << " cells, " << sizeof(table.chars) << " chars\n";
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include "lispvalue.c"
+#include "lispread.c"
+#include "lispwrite.c"
+#include "t/test14.sexp.c"
+
+/* Equal structure, with EQ symbols; follows cycles through EQ pairs only once. */
+static
+int equalQ(VALUE x, VALUE y, int depth)
+{
+  char tx[8], ty[8];
+  size_t lx, ly, i;
+  const char *px, *py;
+
+  if ( x == y )
+    return 1;
+  if ( depth > 20 )
+    return 1;
+  if ( LV_PAIRQ(x) && LV_PAIRQ(y) )
+    return equalQ(lv_car(x), lv_car(y), depth + 1) && equalQ(lv_cdr(x), lv_cdr(y), depth + 1);
+  if ( lv_stringQ(x) && lv_stringQ(y) ) {
+    px = lv_bytes(x, tx, &lx);
+    py = lv_bytes(y, ty, &ly);
+    return lx == ly && ! memcmp(px, py, lx);
+  }
+  if ( LV_FLONUMQ(x) && LV_FLONUMQ(y) )
+    return LV_FLONUM_VALUE(x) == LV_FLONUM_VALUE(y);
+  if ( LV_VECTORQ(x) && LV_VECTORQ(y) ) {
+    if ( LV_LENGTH(x) != LV_LENGTH(y) )
+      return 0;
+    for ( i = 0; i < LV_LENGTH(x); ++ i ) {
+      if ( ! equalQ(LV_VECTOR_REF(x, i), LV_VECTOR_REF(y, i), depth + 1) )
+	return 0;
+    }
+    return 1;
+  }
+  if ( LV_TYPEQ(x, LV_TYPED_VECTOR) && LV_TYPEQ(y, LV_TYPED_VECTOR) ) {
+    struct lv_typed_vector *a = (void*) LV_OBJECT(x), *b = (void*) LV_OBJECT(y);
+    return a->kind == b->kind && LV_LENGTH(x) == LV_LENGTH(y);
+  }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  VALUE x;
+  size_t i;
+
+  printf("init: %d\n", test14_init());
+  for ( i = 0; i < test14_n; ++ i ) {
+    lv_write(test14_data[i], LV_STREAM(stdout));
+    if ( lv_read_file(stdin, &x) ) {
+      printf("  ; ERROR: %s\n", lv_error_message);
+      continue;
+    }
+    printf("  ; %s\n", equalQ(x, test14_data[i], 0) ? "same as read" : "DIFFERS from read");
+  }
+  printf("shared: %d\n", lv_car(test14_data[7]) == lv_car(lv_cdr(test14_data[7])));
+  printf("eq symbol: %d\n", LV_VECTOR_REF(test14_data[2], 0) == lv_intern("a-long-symbol-name", 18));
+  printf("allocated: %lu\n", (unsigned long) lv_allocated);
+  lv_reset();
+  return 0;
+}
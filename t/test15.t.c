@@ -0,0 +1,64 @@
+#include "lispvalue.c"
+#include "lispread.c"
+#include "lispwrite.c"
+
+struct event {
+  long id;
+  char kind[16];
+  char name[24];
+  double v[4];
+  size_t v_n;
+};
+
+#define RECORD_DECL static const char *read_event(const char *p, const char *end, struct event *r)
+#define RECORD_FIELDS(F) F(SYMBOL_IS, event) F(LONG, id) F(SYMBOL, kind) F(STRING, name) F(DOUBLES, v)
+#include "lisprecord.c"
+
+struct point {
+  long xy[2];
+  size_t xy_n;
+  double weight;
+};
+
+#define RECORD_DECL static const char *read_point(const char *p, const char *end, struct point *r)
+#define RECORD_FIELDS(F) F(SYMBOL_IS, point) F(LONGS, xy) F(DOUBLE, weight)
+#include "lisprecord.c"
+
+int main(int argc, char **argv)
+{
+  static char buf[64 * 1024];
+  size_t n = fread(buf, 1, sizeof(buf), stdin);
+  const char *p = buf, *end = buf + n, *q;
+  struct event ev;
+  struct point pt;
+  size_t i;
+
+  while ( 1 ) {
+    p = record_skip(p, end);
+    if ( p == end )
+      break;
+    if ( (q = read_event(p, end, &ev)) ) {
+      printf("event: id=%ld kind=%s name=\"%s\" v=(", ev.id, ev.kind, ev.name);
+      for ( i = 0; i < ev.v_n; ++ i )
+	printf("%s%g", i ? " " : "", ev.v[i]);
+      printf(")\n");
+    } else if ( (q = read_point(p, end, &pt)) ) {
+      printf("point: xy=(%ld %ld) n=%lu weight=%g\n", pt.xy[0], pt.xy[1], (unsigned long) pt.xy_n, pt.weight);
+    } else {
+      /* Not a record: read it with lispread.c. */
+      FILE *fp = fmemopen((void*) p, end - p, "r");
+      VALUE x;
+      printf("generic: ");
+      if ( lv_read_file(fp, &x) )
+	printf("ERROR: %s", lv_error_message);
+      else
+	lv_write(x, LV_STREAM(stdout));
+      printf("\n");
+      q = p + ftell(fp);
+      fclose(fp);
+    }
+    p = q;
+  }
+  lv_reset();
+  return 0;
+}
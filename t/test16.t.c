@@ -0,0 +1,45 @@
+#include "lispvalue.c"
+#include "t/test16.syms.c"
+
+static VALUE known_values[256];
+static unsigned long known_lookups, known_hits;
+
+#define KNOWN_SYMBOL(P,LEN) (++ known_lookups, test16_lookup(P, LEN))
+#define KNOWN_SYMBOL_VALUE(ID) (++ known_hits, known_values[ID])
+
+#include "lispread.c"
+#include "lispwrite.c"
+
+int main(int argc, char **argv)
+{
+  static const char *unknown[] = { "", "defin", "definee", "lambda ", "LAMBDA", "set", "vector-set", "car!", "a-rather-long-symbol-in-the-vocabularY" };
+  VALUE x;
+  size_t i, bad = 0;
+
+  for ( i = 0; i < test16_n; ++ i ) {
+    known_values[i] = lv_intern(test16_name(i), strlen(test16_name(i)));
+    if ( test16_lookup(test16_name(i), strlen(test16_name(i))) != (int) i )
+      ++ bad;
+  }
+  for ( i = 0; i < sizeof(unknown) / sizeof(unknown[0]); ++ i ) {
+    if ( test16_lookup(unknown[i], strlen(unknown[i])) != -1 )
+      ++ bad;
+  }
+  printf("%lu known symbols, %lu lookups wrong\n", (unsigned long) test16_n, (unsigned long) bad);
+  printf("ids: define=%d set!=%d pair?=%d ...=%d\n", test16_ID_define, test16_ID_setX, test16_ID_pairQ, test16_ID____);
+
+  while ( 1 ) {
+    if ( lv_read_file(stdin, &x) ) {
+      printf("ERROR: %s\n", lv_error_message);
+      continue;
+    }
+    if ( EQ(x, EOS) )
+      break;
+    lv_write(x, LV_STREAM(stdout));
+    printf("\n");
+  }
+  printf("lookups: %lu, known: %lu\n", known_lookups, known_hits);
+  printf("eq: %d\n", lv_intern("a-rather-long-symbol-in-the-vocabulary", 38) == known_values[test16_ID_a_rather_long_symbol_in_the_vocabulary]);
+  lv_reset();
+  return 0;
+}
@@ -0,0 +1,76 @@
+#define READ_MACROS 1
+#include "lispvalue.c"
+#include "lispread.c"
+#include "lispwrite.c"
+
+/* {k v ...} => (map k v ...) */
+static int read_map(VALUE stream, int c, VALUE *xp)
+{
+  *xp = CONS(SYMBOL(map), read_macro_list(stream, '}'));
+  return 1;
+}
+
+/* @NAME DATUM => (annotate NAME DATUM) */
+static int read_annotation(VALUE stream, int c, VALUE *xp)
+{
+  VALUE name = lv_read(stream), x = lv_read(stream);
+  if ( EQ(x, EOS) )
+    ERROR("eos after '@'");
+  *xp = CONS(SYMBOL(annotate), CONS(name, CONS(x, NIL)));
+  return 1;
+}
+
+/* [a b ...] => (array a b ...), replacing the built-in bracket lists. */
+static int read_array(VALUE stream, int c, VALUE *xp)
+{
+  *xp = CONS(SYMBOL(array), read_macro_list(stream, ']'));
+  return 1;
+}
+
+/* #@DATUM is a comment. */
+static int read_hash_comment(VALUE stream, int c, VALUE *xp)
+{
+  lv_read(stream);
+  return 0;
+}
+
+static void read_all(FILE *fp)
+{
+  VALUE x;
+
+  while ( 1 ) {
+    if ( lv_read_file(fp, &x) ) {
+      printf("ERROR: %s\n", lv_error_message);
+      continue;
+    }
+    if ( EQ(x, EOS) )
+      break;
+    lv_write(x, LV_STREAM(stdout));
+    printf("\n");
+  }
+}
+
+int main(int argc, char **argv)
+{
+  static const char builtin[] = "{a 1} [x y] a@b #@c d";
+  static struct read_macros m;
+  FILE *fp;
+
+  printf("+ built-in syntax\n");
+  fp = fmemopen((void*) builtin, sizeof(builtin) - 1, "r");
+  read_all(fp);
+  fclose(fp);
+
+  read_macros_init(&m);
+  read_macros_set(&m, '{', read_map, 1);
+  read_macros_set(&m, '}', 0, 1);
+  read_macros_set(&m, '@', read_annotation, 0);
+  read_macros_set(&m, '[', read_array, 1);
+  read_macros_set_hash(&m, '@', read_hash_comment);
+  READ_CTX->macros = &m;
+
+  printf("+ read macros\n");
+  read_all(stdin);
+  lv_reset();
+  return 0;
+}
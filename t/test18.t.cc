@@ -0,0 +1,67 @@
+#define TEST_NO_MAIN
+#include "t/test9.t.cc"
+
+#include <sstream>
+
+/* Checks every scanning kernel this CPU runs against the scalar ones,
+   then reads the input with each of them. */
+
+static const char *const levels[] = { "scalar", "sse42", "avx2", "avx512" };
+
+static bool kernels_agree(const lispread::simd::kernels &k, const std::string &buf)
+{
+  const lispread::simd::kernels &s = *lispread::simd::kernels_for("scalar");
+  for ( std::size_t off = 0; off < 64; ++ off ) {
+    for ( std::size_t n = 0; off + n <= buf.size() && n < 200; ++ n ) {
+      const char *p = buf.data() + off;
+      if ( k.skip_space(p, n) != s.skip_space(p, n)
+           || k.find_quote(p, n) != s.find_quote(p, n)
+           || k.find_either(p, n, '|', '#') != s.find_either(p, n, '|', '#')
+           || k.find_terminator(p, n, false) != s.find_terminator(p, n, false)
+           || k.find_terminator(p, n, true) != s.find_terminator(p, n, true) )
+        return false;
+    }
+  }
+  return true;
+}
+
+int main()
+{
+  std::string text((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+  std::string expected, buf;
+  unsigned long seed = 1;
+
+  setenv("LISPREAD_SIMD", "scalar", 1);
+  std::cout << "LISPREAD_SIMD=scalar: " << lispread::simd::active().name << "\n";
+  std::cout << "unknown: " << (lispread::simd::kernels_for("mmx") ? "found" : "none") << "\n";
+
+  /* Runs of whitespace and token bytes, with every byte value. */
+  for ( int i = 0; i < 4096; ++ i ) {
+    seed = seed * 1103515245 + 12345;
+    int r = (seed >> 16) % 8, c = (seed >> 8) & 0xff;
+    std::size_t len = 1 + (seed >> 24) % 40;
+    buf.append(len, r < 3 ? " \t\n\v\f\r"[c % 6] : r < 6 ? "abc-1?!|#"[c % 9] : (char) c);
+  }
+  bool agree = true;
+  for ( const char *level : levels ) {
+    if ( auto k = lispread::simd::kernels_for(level) )
+      agree = agree && kernels_agree(*k, buf);
+  }
+  std::cout << "kernels agree: " << (agree ? "yes" : "NO") << "\n";
+
+  for ( const char *level : levels ) {
+    if ( ! lispread::simd::use(level) )
+      continue;
+    std::ostringstream out;
+    lispread::string_input in(text), in2(text);
+    read_all<obj_traits>(out, in, print_obj);
+    out << "+ strict_traits\n";
+    read_all<strict_traits>(out, in2, print_obj);
+    if ( expected.empty() )
+      expected = out.str();
+    else if ( out.str() != expected )
+      std::cout << level << ": DIFFERS\n" << out.str();
+  }
+  std::cout << expected;
+  return 0;
+}
@@ -0,0 +1,60 @@
+#define TEST_NO_MAIN
+#include "t/test9.t.cc"
+
+#include <sstream>
+
+/* Reads long and nested #| comments |# and #! lines with each scanning
+   kernel this CPU runs, in windows of several sizes. */
+
+static const char *const levels[] = { "scalar", "sse42", "avx2", "avx512" };
+
+int main()
+{
+  std::string text((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+  std::string expected;
+  bool same = true;
+
+  /* A comment of several kilobytes, with stray '|' and '#' bytes. */
+  text += "#| generated";
+  for ( int i = 0; i < 200; ++ i )
+    text += i % 50 ? " (commented out datum #x1f | a|b #\\a)\n" : " #| nested #| deeper |# |# |a|b| # |x| #\n";
+  text += "|# after-generated\n";
+
+  {
+    std::ostringstream out;
+    lispread::string_input in(text);
+    read_all<obj_traits>(out, in, print_obj);
+    expected = out.str();
+  }
+
+  for ( const char *level : levels ) {
+    if ( ! lispread::simd::use(level) )
+      continue;
+    for ( std::size_t size : { 1, 2, 13, 100, 0 } ) {
+      std::vector<struct iovec> iov;
+      if ( ! size )
+        size = text.size();
+      for ( std::size_t i = 0; i < text.size(); i += size ) {
+        struct iovec v = { (void*) (text.data() + i), std::min(size, text.size() - i) };
+        iov.push_back(v);
+      }
+      std::ostringstream out;
+      lispread::iovec_input in(iov.data(), iov.size());
+      read_all<obj_traits>(out, in, print_obj);
+      if ( out.str() != expected ) {
+        std::cout << level << " " << size << ": DIFFERS\n" << out.str();
+        same = false;
+      }
+    }
+  }
+  std::cout << "kernels and windows: " << (same ? "same" : "DIFFER") << "\n";
+  std::cout << expected;
+
+  {
+    std::ostringstream out;
+    lispread::string_input in("a #| unterminated #| nested |# comment");
+    read_all<obj_traits>(out, in, print_obj);
+    std::cout << out.str();
+  }
+  return 0;
+}
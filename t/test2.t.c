@@ -0,0 +1,5 @@
+/* test1.t.c with hash-consing. */
+#define READ_HASH_CONS 1
+#define READ_HASH_CONS_SIZE 64
+#define HASH_VALUE(X) P(X)
+#include "t/test1.t.c"
@@ -0,0 +1,44 @@
+#define READ_UTF8 1
+#define READ_STRING_CACHE 1
+#include "lispvalue.c"
+#include "lispread.c"
+#include "lispwrite.c"
+
+int main(int argc, char **argv)
+{
+  static const char *valid[] = { "", "ascii only, longer than a word", "\xce\xbb", "\xe6\x97\xa5\xe6\x9c\xac", "\xf0\x9f\x98\x80", "\xf4\x8f\xbf\xbf", "abcdefgh\xc3\xa9ijklmnop" };
+  static const char *invalid[] = { "\x80", "\xc0\xaf", "\xc1\xbf", "\xe0\x80\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\xce", "abcdefgh\xe6\x97", "\xce\xbb\xff" };
+  VALUE x;
+  size_t i, size = 0;
+  ssize_t n;
+  char *line = 0;
+  int bad = 0;
+
+  for ( i = 0; i < sizeof(valid) / sizeof(valid[0]); ++ i )
+    bad += ! read_utf8_validQ(valid[i], strlen(valid[i]));
+  for ( i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++ i )
+    bad += read_utf8_validQ(invalid[i], strlen(invalid[i]));
+  printf("validator: %d wrong\n", bad);
+
+  /* Each line is read by itself, so an error only loses the rest of it. */
+  while ( (n = getline(&line, &size, stdin)) > 0 ) {
+    FILE *fp = fmemopen(line, n, "r");
+    while ( 1 ) {
+      if ( lv_read_file(fp, &x) ) {
+        printf("ERROR: %s\n", lv_error_message);
+        break;
+      }
+      if ( EQ(x, EOS) )
+        break;
+      lv_write(x, LV_STREAM(stdout));
+      if ( LV_CHARQ(x) )
+        printf(" ; U+%04X", LV_CHAR_VALUE(x));
+      printf("\n");
+    }
+    fclose(fp);
+  }
+  free(line);
+  printf("string_cache_hits = %lu\n", string_cache_hits);
+  lv_reset();
+  return 0;
+}
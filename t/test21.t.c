@@ -0,0 +1,36 @@
+#include <stdlib.h>
+
+static unsigned long mallocs;
+
+#define MALLOC(S)       (++ mallocs, malloc(S))
+#define REALLOC(P,S)    (++ mallocs, realloc(P,S))
+
+#include "lispvalue.c"
+#include "lispread.c"
+#include "lispwrite.c"
+
+int main(int argc, char **argv)
+{
+  static const char *names[] = { "alarm", "backspace", "delete", "escape", "newline", "null", "return", "space", "tab" };
+  VALUE x;
+  size_t i;
+
+  for ( i = 0; i < sizeof(names) / sizeof(names[0]); ++ i )
+    printf("%s: %d\n", names[i], read_char_name(names[i], strlen(names[i])));
+
+  while ( 1 ) {
+    unsigned long before = mallocs;
+    if ( lv_read_file(stdin, &x) ) {
+      printf("ERROR: %s\n", lv_error_message);
+      continue;
+    }
+    if ( EQ(x, EOS) )
+      break;
+    lv_write(x, LV_STREAM(stdout));
+    if ( LV_CHARQ(x) )
+      printf(" ; %d, %lu mallocs", LV_CHAR_VALUE(x), mallocs - before);
+    printf("\n");
+  }
+  lv_reset();
+  return 0;
+}
@@ -0,0 +1,70 @@
+#define TEST_NO_MAIN
+#include "t/test9.t.cc"
+
+#include <sstream>
+
+/* Reads the input through readahead_input with both backends, with datums
+   straddling buffers as small as one byte, and from an offset in the file. */
+
+static std::string expected;
+
+static void check(const char *name, lispread::readahead_input &in)
+{
+  std::ostringstream out;
+  read_all<obj_traits>(out, in, print_obj);
+  std::cout << name << ": " << (out.str() == expected ? "same" : "DIFFERS") << "\n";
+  if ( out.str() != expected )
+    std::cout << out.str();
+}
+
+int main()
+{
+  std::string text((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+  char name[64];
+
+  {
+    std::ostringstream out;
+    lispread::string_input in(text);
+    read_all<obj_traits>(out, in, print_obj);
+    expected = out.str();
+    std::cout << expected;
+  }
+
+  std::FILE *fp = std::tmpfile();
+  std::fwrite("skipped ", 1, 8, fp);
+  std::fwrite(text.data(), 1, text.size(), fp);
+  std::fflush(fp);
+
+  for ( bool uring : { true, false } ) {
+    for ( std::size_t depth : { 1, 2, 8 } ) {
+      for ( std::size_t size : { 1, 3, 64, 1024 * 1024 } ) {
+        lseek(fileno(fp), 8, SEEK_SET);
+        lispread::readahead_input in(fileno(fp), depth, size, uring);
+        std::snprintf(name, sizeof(name), "readahead_input %s %lu %lu", uring ? "any" : "pread",
+                      (unsigned long) depth, (unsigned long) size);
+        check(name, in);
+      }
+    }
+  }
+
+  /* A buffer that is dropped half read. */
+  {
+    lseek(fileno(fp), 8, SEEK_SET);
+    lispread::readahead_input in(fileno(fp), 4, 16);
+    obj_traits::value x = lispread::reader<obj_traits, lispread::readahead_input>(in).read();
+    write(std::cout, x);
+    std::cout << "\n";
+  }
+
+  try {
+    int fds[2];
+    if ( pipe(fds) < 0 )
+      return 1;
+    lispread::readahead_input in(fds[0]);
+  } catch ( const lispread::error &e ) {
+    std::cout << "ERROR: " << e.what() << "\n";
+  }
+
+  std::fclose(fp);
+  return 0;
+}
@@ -0,0 +1,34 @@
+/* Reads the input, frees everything with lv_reset() and reads it again:
+   the string cache and the hash-cons table must not hand back freed VALUEs. */
+#define READ_HASH_CONS 1
+#define READ_HASH_CONS_SIZE 64
+#include "lispvalue.c"
+#include "lispread.c"
+#include "lispwrite.c"
+
+int main(int argc, char **argv)
+{
+  char buf[4096];
+  size_t n = fread(buf, 1, sizeof(buf), stdin);
+  int pass;
+  VALUE x;
+
+  for ( pass = 1; pass <= 3; ++ pass ) {
+    FILE *fp = fmemopen(buf, n, "r");
+    printf("pass %d\n", pass);
+    while ( 1 ) {
+      if ( lv_read_file(fp, &x) ) {
+        printf("ERROR: %s\n", lv_error_message);
+        break;
+      }
+      if ( EQ(x, EOS) )
+        break;
+      lv_write(x, LV_STREAM(stdout));
+      printf("\n");
+    }
+    fclose(fp);
+    printf("string_cache_hits = %lu\n", string_cache_hits);
+    lv_reset();
+  }
+  return 0;
+}
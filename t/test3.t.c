@@ -0,0 +1,17 @@
+/* test1.t.c with the reader's symbol table. */
+static void *make_symbol(void *x);
+#define READ_SYMBOL_TABLE 1
+#define READ_SYMBOL_MAX 8
+#define MAKE_SYMBOL(X)  make_symbol(X)
+#define SYMBOL(NAME)    symbol_table_intern(#NAME, sizeof(#NAME) - 1, 1)
+#define SYMBOL_DOT      SYMBOL(.)
+#include "t/test1.t.c"
+
+static
+void *make_symbol(void *x)
+{
+  const char *s = x;
+  void *v = strcpy(test_malloc(strlen(s) + 1), s);
+  printf("MAKE_SYMBOL(%s) => 0x%lx\n", s, P(v));
+  return v;
+}
@@ -0,0 +1,63 @@
+/* test1.t.c with datum labels, written back with lispwrite.c. */
+#include <stdio.h>
+static int pairQ(void *x);
+static void *cdr(void *x);
+static void set_car(void *x, void *v);
+static void test_write(void *x, FILE *stream);
+#define READ_DATUM_LABELS 1
+#define PAIRQ(X)        pairQ(X)
+#define CDR(X)          cdr(X)
+#define SET_CAR(X,V)    set_car(X,V)
+#define TEST_WRITE(X)   test_write(X, stdout)
+#include "t/test1.t.c"
+
+static
+int pairQ(void *x)
+{
+  struct alloc *a = find_alloc(x);
+  return a && a->type == 'p';
+}
+
+static
+void *cdr(void *x)
+{
+  printf("CDR(0x%lx)\n", P(x));
+  return ((struct pair*) x)->cdr;
+}
+
+static
+void set_car(void *x, void *v)
+{
+  printf("SET_CAR(0x%lx,0x%lx)\n", P(x), P(v));
+  ((struct pair*) x)->car = v;
+}
+
+static
+void write_atom(FILE *stream, VALUE x)
+{
+  struct alloc *a = find_alloc(x);
+  int i;
+  for ( i = 0; i < symbols_n; ++ i ) {
+    if ( x == symbols[i].name ) {
+      fputs(x, stream);
+      return;
+    }
+  }
+  if ( x == NIL )
+    fputs("()", stream);
+  else if ( a )
+    fprintf(stream, "\"%s\"", (char*) x);
+  else
+    fprintf(stream, "%ld", (long) x - 8192);
+}
+
+#undef CAR
+#undef CDR
+#undef MALLOC
+#undef FREE
+#define CAR(X)          (((struct pair*) (X))->car)
+#define CDR(X)          (((struct pair*) (X))->cdr)
+#define WRITE_DECL      static void test_write(VALUE x, FILE *stream)
+#define PUTS(S,STR)     fputs(STR,S)
+#define WRITE_ATOM(S,X) write_atom(S,X)
+#include "lispwrite.c"
@@ -0,0 +1,49 @@
+#include "lispvalue.c"
+#include "lispread.c"
+#include "lispwrite.c"
+
+int main(int argc, char **argv)
+{
+  VALUE x;
+#ifdef READ_YIELD
+  unsigned long yields = 0;
+  READ_CTX->budget = 4;
+#endif
+
+#ifdef READ_LIMITS
+  READ_CTX->limits[READ_LIMIT_DEPTH] = 8;
+  READ_CTX->limits[READ_LIMIT_TOKEN] = 16;
+  READ_CTX->limits[READ_LIMIT_DATUM] = 256;
+  READ_CTX->limits[READ_LIMIT_ALLOC] = 1024;
+#endif
+  while ( 1 ) {
+    if ( lv_read_file(stdin, &x) ) {
+      printf("ERROR: %s\n", lv_error_message);
+#ifdef READ_YIELD
+      yields = 0;
+#endif
+      continue;
+    }
+#ifdef READ_YIELD
+    if ( EQ(x, YIELD) ) {
+      if ( ++ yields == 40 )
+        READ_CTX->cancel = 1;
+      continue;
+    }
+#endif
+    if ( EQ(x, EOS) )
+      break;
+    lv_write(x, LV_STREAM(stdout));
+#ifdef READ_YIELD
+    printf("  ; %lu yields", yields);
+    yields = 0;
+#endif
+#ifdef READ_LIMITS
+    printf("  ; %lu bytes, %lu allocated", (unsigned long) (READ_CTX->bytes - READ_CTX->datum_start), (unsigned long) READ_CTX->allocated);
+#endif
+    printf("\n");
+  }
+  printf("allocated: %lu\n", (unsigned long) lv_allocated);
+  lv_reset();
+  return 0;
+}
@@ -0,0 +1,2 @@
+#define LV_CDR_CODING 1
+#include "t/test5.t.c"
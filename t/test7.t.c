@@ -0,0 +1,2 @@
+#define READ_LIMITS 1
+#include "t/test5.t.c"
@@ -0,0 +1,222 @@
+#include "lispread.hpp"
+
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+/* A small value model: every value is an obj in an arena. */
+struct obj {
+  enum kind_t { NIL, CONST, PAIR, SYMBOL, STRING, FIXNUM, FLONUM, CHAR, VECTOR } kind;
+  std::string s;
+  long long i = 0;
+  double d = 0;
+  obj *car = 0, *cdr = 0;
+  std::vector<obj*> v;
+};
+
+static std::deque<obj> arena;
+static std::map<std::string, obj*, std::less<>> symbols;
+
+static obj *make(obj::kind_t kind, std::string_view s = "")
+{
+  arena.push_back(obj());
+  arena.back().kind = kind;
+  arena.back().s = s;
+  return &arena.back();
+}
+
+static obj constant(obj::kind_t kind, const char *name)
+{
+  obj x;
+  x.kind = kind;
+  x.s = name;
+  return x;
+}
+
+static obj nil_obj = constant(obj::NIL, "()"), eos_obj = constant(obj::CONST, "#<eos>");
+static obj t_obj = constant(obj::CONST, "#t"), f_obj = constant(obj::CONST, "#f"), u_obj = constant(obj::CONST, "#u");
+
+struct obj_traits {
+  using value = obj*;
+  static value nil() { return &nil_obj; }
+  static value eos() { return &eos_obj; }
+  static value t() { return &t_obj; }
+  static value f() { return &f_obj; }
+  static bool eq(value x, value y) { return x == y; }
+  static value cons(value a, value d) { obj *p = make(obj::PAIR); p->car = a; p->cdr = d; return p; }
+  static value make_char(int c) { obj *x = make(obj::CHAR); x->i = c; return x; }
+  static value list_2_vector(value l)
+  {
+    obj *x = make(obj::VECTOR);
+    for ( ; l->kind == obj::PAIR; l = l->cdr )
+      x->v.push_back(l->car);
+    return x;
+  }
+  static value string(std::string_view s) { return make(obj::STRING, s); }
+  static value string_2_number(std::string_view s, int radix)
+  {
+    std::string str(s);
+    char *end;
+    const char *p = str.c_str();
+    if ( *p == '+' || *p == '-' ) ++ p;
+    if ( ! (std::isdigit((unsigned char) *p) || (radix == 16 && std::isxdigit((unsigned char) *p))) )
+      return f();
+    long long i = std::strtoll(str.c_str(), &end, radix);
+    if ( ! *end ) {
+      obj *x = make(obj::FIXNUM, s);
+      x->i = i;
+      return x;
+    }
+    if ( radix != 10 )
+      return f();
+    double d = std::strtod(str.c_str(), &end);
+    if ( *end )
+      return f();
+    obj *x = make(obj::FLONUM, s);
+    x->d = d;
+    return x;
+  }
+  static value symbol(std::string_view s)
+  {
+    auto i = symbols.find(s);
+    if ( i != symbols.end() )
+      return i->second;
+    return symbols[std::string(s)] = make(obj::SYMBOL, s);
+  }
+  static value string_2_symbol(std::string_view s) { return symbol(s); }
+
+  static constexpr bool bracket_lists = true;
+  static constexpr bool unspecified = true;
+  static value u() { return &u_obj; }
+};
+
+/* The same values without [...] and #u, with lists made in one call. */
+struct strict_traits : obj_traits {
+  static constexpr bool bracket_lists = false;
+  static constexpr bool unspecified = false;
+  static unsigned long lists;
+  static value make_list(const value *p, std::size_t n, value tail)
+  {
+    ++ lists;
+    while ( n > 0 )
+      tail = cons(p[-- n], tail);
+    return tail;
+  }
+};
+unsigned long strict_traits::lists;
+
+/* A third reader over a different value type: counts atoms. */
+struct count_traits {
+  using value = long;
+  static value nil() { return 0; }
+  static value eos() { return -1; }
+  static value t() { return 1; }
+  static value f() { return -2; }
+  static bool eq(value x, value y) { return x == y; }
+  static value cons(value a, value d) { return a + d; }
+  static value make_char(int) { return 1; }
+  static value list_2_vector(value l) { return l; }
+  static value string(std::string_view) { return 1; }
+  static value string_2_number(std::string_view s, int radix) { return radix != 10 || std::isdigit((unsigned char) s[0]) ? 1 : f(); }
+  static value string_2_symbol(std::string_view s) { return s == "." ? -3 : 1; }
+  static value symbol(std::string_view s) { return s == "." ? -3 : 0; }
+  static constexpr bool macro_chars = true;
+  static bool call_macro_char(int c, value &x) { x = 100 + c; return c != '?'; }
+};
+
+static void write(std::ostream &out, const obj *x)
+{
+  switch ( x->kind ) {
+  case obj::PAIR:
+    out << "(";
+    while ( 1 ) {
+      write(out, x->car);
+      x = x->cdr;
+      if ( x->kind == obj::NIL )
+        break;
+      if ( x->kind != obj::PAIR ) {
+        out << " . ";
+        write(out, x);
+        break;
+      }
+      out << " ";
+    }
+    out << ")";
+    break;
+  case obj::VECTOR:
+    out << "#(";
+    for ( std::size_t i = 0; i < x->v.size(); ++ i )
+      write(out, x->v[i]), out << (i + 1 < x->v.size() ? " " : "");
+    out << ")";
+    break;
+  case obj::STRING:
+    out << '"';
+    for ( char c : x->s ) {
+      if ( c == '"' || c == '\\' ) out << '\\' << c;
+      else if ( c == '\n' ) out << "\\n";
+      else out << c;
+    }
+    out << '"';
+    break;
+  case obj::CHAR:
+    if ( x->i == ' ' ) out << "#\\space";
+    else if ( x->i == '\n' ) out << "#\\newline";
+    else if ( x->i < ' ' || x->i >= 127 ) out << "#\\x" << std::hex << x->i << std::dec;
+    else out << "#\\" << (char) x->i;
+    break;
+  case obj::FIXNUM:
+    out << x->i;
+    break;
+  case obj::FLONUM:
+    out << x->d;
+    break;
+  default:
+    out << x->s;
+  }
+}
+
+static void print_obj(std::ostream &out, obj *x) { write(out, x); }
+
+template <class Traits, class Input, class Print>
+static void read_all(std::ostream &out, Input &in, Print print)
+{
+  lispread::reader<Traits, Input> r(in);
+
+  while ( 1 ) {
+    try {
+      typename Traits::value x = r.read();
+      if ( Traits::eq(x, Traits::eos()) )
+        break;
+      print(out, x);
+      out << "\n";
+    } catch ( const lispread::error &e ) {
+      out << "ERROR: " << e.what() << "\n";
+    }
+  }
+}
+
+template <class Traits, class Print>
+static void read_all(const char *name, std::string_view text, Print print)
+{
+  lispread::string_input in(text);
+
+  std::cout << "+ " << name << "\n";
+  read_all<Traits>(std::cout, in, print);
+}
+
+#ifndef TEST_NO_MAIN
+int main()
+{
+  std::string text((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+
+  read_all<obj_traits>("obj_traits", text, print_obj);
+  read_all<strict_traits>("strict_traits", text, print_obj);
+  std::cout << "strict_traits::lists = " << strict_traits::lists << "\n";
+  read_all<count_traits>("count_traits", text, [](std::ostream &out, long n) { out << n << " atoms"; });
+  return 0;
+}
+#endif